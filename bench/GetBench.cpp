@@ -0,0 +1,113 @@
+#include <SimpleEngine.hpp>
+
+#include <cstdio>
+#include <cstdint>
+#include <chrono>
+#include <vector>
+#include <random>
+#include <algorithm>
+
+// times single component lookups, through pools directly and through the engine, in index order and shuffled
+
+class BenchSystem : public SimpleEngine<BenchSystem, 32>::BaseSystem {};
+
+struct Position {
+	float x, y, z;
+};
+
+struct Health {
+	float value;
+	uint32_t flags;
+};
+
+template <>
+struct ComponentPool<Health> {
+	using type = SparsePool<Health>;
+};
+
+struct Velocity {
+	float x, y, z;
+};
+
+template <>
+struct ComponentPool<Velocity> {
+	using type = ArchetypePool<Velocity>;
+};
+
+// keeps the compiler from dropping the lookups
+volatile float sink = 0.f;
+
+template <typename T>
+double nanoseconds(uint32_t repeats, uint32_t count, const T& lambda) {
+	// once untimed, so pages are committed and cached the same way for every run
+	float sum = lambda();
+
+	auto start = std::chrono::steady_clock::now();
+
+	for (uint32_t i = 0; i < repeats; i++)
+		sum += lambda();
+
+	double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	sink = sum;
+
+	return elapsed * 1e9 / (static_cast<double>(repeats) * count);
+}
+
+int main() {
+	const uint32_t count = 1 << 20;
+	const uint32_t repeats = 20;
+
+	BenchSystem::Engine engine(1024 * 1024);
+
+	std::vector<uint64_t> ids(count);
+	engine.createEntities(count, ids.data());
+
+	engine.addComponents<Position>(ids.data(), count, Position{ 1.f, 2.f, 3.f });
+	engine.addComponents<Health>(ids.data(), count, Health{ 100.f, 0 });
+	engine.addComponents<Velocity>(ids.data(), count, Velocity{ 1.f, 2.f, 3.f });
+
+	// the same pools on their own, without the engine's id and mask checks
+	ObjectPool<Position> objects(1024 * 1024);
+	SparsePool<Position> sparse(1024 * 1024);
+
+	std::vector<uint32_t> indexes(count);
+
+	for (uint32_t i = 0; i < count; i++)
+		indexes[i] = i;
+
+	objects.insertBatch(indexes.data(), count, Position{ 1.f, 2.f, 3.f });
+	sparse.insertBatch(indexes.data(), count, Position{ 1.f, 2.f, 3.f });
+
+	std::vector<uint32_t> shuffled(indexes);
+	std::shuffle(shuffled.begin(), shuffled.end(), std::mt19937(1));
+
+	printf("%u entities, ns per get\n", count);
+	printf("%-32s %10s %10s\n", "", "in order", "shuffled");
+
+	auto row = [&](const char* name, auto get) {
+		auto pass = [&](const std::vector<uint32_t>& order) {
+			return nanoseconds(repeats, count, [&]() {
+				float sum = 0.f;
+
+				for (uint32_t index : order)
+					sum += get(index);
+
+				return sum;
+			});
+		};
+
+		printf("%-32s %10.2f %10.2f\n", name, pass(indexes), pass(shuffled));
+	};
+
+	// the stride read from the pool, as every lookup did before it was known at compile time
+	row("ChunkPool::get, runtime stride", [&](uint32_t index) { return static_cast<ChunkPool&>(objects).get<Position>(index)->y; });
+	row("ObjectPool::get", [&](uint32_t index) { return objects.get(index)->y; });
+	row("SparsePool::get", [&](uint32_t index) { return sparse.get(index)->y; });
+
+	row("getComponent, object pool", [&](uint32_t index) { return engine.getComponent<Position>(ids[index])->y; });
+	row("getComponent, sparse pool", [&](uint32_t index) { return engine.getComponent<Health>(ids[index])->value; });
+	row("getComponent, archetype pool", [&](uint32_t index) { return engine.getComponent<Velocity>(ids[index])->y; });
+
+	return 0;
+}
\ No newline at end of file
@@ -0,0 +1,164 @@
+#include "TransformKernels.hpp"
+
+#include <glm\gtc\matrix_transform.hpp>
+
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+#include <chrono>
+#include <vector>
+#include <random>
+
+// checks every instruction set's kernels against plain glm then times them, "check" skips the timing
+
+static const char* const sets[] = { "scalar", "sse", "avx" };
+
+static void transformReference(const glm::vec3* positions, const glm::quat* rotations, const glm::vec3* scales, glm::mat4* matrices, uint32_t count) {
+	for (uint32_t i = 0; i < count; i++)
+		matrices[i] = glm::scale(glm::translate(glm::mat4(), positions[i]) * glm::mat4_cast(rotations[i]), scales[i]);
+}
+
+static void multiplyReference(const glm::mat4& left, const glm::mat4* rights, glm::mat4* results, uint32_t count) {
+	for (uint32_t i = 0; i < count; i++)
+		results[i] = left * rights[i];
+}
+
+static bool close(const glm::mat4& a, const glm::mat4& b) {
+	for (int i = 0; i < 4; i++) {
+		for (int j = 0; j < 4; j++) {
+			if (std::fabs(a[i][j] - b[i][j]) > 1e-5f * (1.f + std::fabs(b[i][j])))
+				return false;
+		}
+	}
+
+	return true;
+}
+
+// every count up to a few times the widest kernel's lanes, starting a few elements in so nothing is aligned
+static bool check(const char* set) {
+	const uint32_t most = 40;
+	const uint32_t offsets = 4;
+
+	std::mt19937 random(7);
+	std::uniform_real_distribution<float> unit(-1.f, 1.f);
+
+	std::vector<glm::vec3> positions(most + offsets);
+	std::vector<glm::quat> rotations(most + offsets);
+	std::vector<glm::vec3> scales(most + offsets);
+	std::vector<glm::mat4> rights(most + offsets);
+
+	for (uint32_t i = 0; i < most + offsets; i++) {
+		positions[i] = glm::vec3(unit(random) * 10.f, unit(random) * 10.f, unit(random) * 10.f);
+		rotations[i] = glm::normalize(glm::quat(unit(random), unit(random), unit(random), unit(random)));
+		scales[i] = glm::vec3(unit(random) + 1.5f, unit(random) + 1.5f, unit(random) + 1.5f);
+	}
+
+	transformReference(positions.data(), rotations.data(), scales.data(), rights.data(), most + offsets);
+
+	const glm::mat4 left = rights[0];
+	const glm::mat4 untouched = glm::translate(glm::mat4(), glm::vec3(7.f, 7.f, 7.f));
+
+	for (uint32_t offset = 0; offset < offsets; offset++) {
+		for (uint32_t count = 0; offset + count <= most; count++) {
+			std::vector<glm::mat4> expected(most + offsets, untouched);
+			std::vector<glm::mat4> matrices(most + offsets, untouched);
+
+			transformReference(&positions[offset], &rotations[offset], &scales[offset], &expected[offset], count);
+			transformMatrices(&positions[offset], &rotations[offset], &scales[offset], &matrices[offset], count);
+
+			for (uint32_t i = 0; i < most + offsets; i++) {
+				if (!close(matrices[i], expected[i])) {
+					printf("%s transformMatrices wrong at %u of %u from %u\n", set, i, count, offset);
+					return false;
+				}
+			}
+
+			// in place too, as the results can be the rights
+			std::vector<glm::mat4> products(rights);
+			expected = rights;
+
+			multiplyReference(left, &rights[offset], &expected[offset], count);
+			multiplyMatrices(left, &products[offset], &products[offset], count);
+
+			for (uint32_t i = 0; i < most + offsets; i++) {
+				if (!close(products[i], expected[i])) {
+					printf("%s multiplyMatrices wrong at %u of %u from %u\n", set, i, count, offset);
+					return false;
+				}
+			}
+		}
+	}
+
+	return true;
+}
+
+template <typename T>
+double nanoseconds(uint32_t repeats, uint32_t count, const T& lambda) {
+	// once untimed, so memory is touched and caches are warm the same way for every run
+	lambda();
+
+	auto start = std::chrono::steady_clock::now();
+
+	for (uint32_t i = 0; i < repeats; i++)
+		lambda();
+
+	double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	return elapsed * 1e9 / (static_cast<double>(repeats) * count);
+}
+
+int main(int argc, char** argv) {
+	const bool timing = argc < 2 || strcmp(argv[1], "check");
+
+	printf("cpu picks %s\n", transformKernels());
+
+	bool passed = true;
+
+	for (const char* set : sets) {
+		if (!useTransformKernels(set)) {
+			printf("%s unsupported, skipped\n", set);
+			continue;
+		}
+
+		bool correct = check(set);
+		printf("%s %s\n", set, correct ? "matches glm" : "doesn't match glm");
+
+		passed = passed && correct;
+	}
+
+	if (!passed || !timing)
+		return passed ? 0 : 1;
+
+	// a level's worth of transforms, small enough to stay in cache
+	const uint32_t count = 4096;
+	const uint32_t repeats = 2000;
+
+	std::vector<glm::vec3> positions(count, glm::vec3(1.f, 2.f, 3.f));
+	std::vector<glm::quat> rotations(count, glm::normalize(glm::quat(1.f, 2.f, 3.f, 4.f)));
+	std::vector<glm::vec3> scales(count, glm::vec3(1.f, 2.f, 1.f));
+	std::vector<glm::mat4> matrices(count);
+	std::vector<glm::mat4> products(count);
+
+	const glm::mat4 left = glm::translate(glm::mat4(), glm::vec3(1.f, 0.f, 0.f));
+
+	printf("%u transforms, ns per transform\n", count);
+	printf("%-8s %10s %10s\n", "", "transform", "multiply");
+
+	double transform = nanoseconds(repeats, count, [&]() { transformReference(positions.data(), rotations.data(), scales.data(), matrices.data(), count); });
+	double multiply = nanoseconds(repeats, count, [&]() { multiplyReference(left, matrices.data(), products.data(), count); });
+
+	printf("%-8s %10.2f %10.2f\n", "glm", transform, multiply);
+
+	for (const char* set : sets) {
+		if (!useTransformKernels(set))
+			continue;
+
+		transform = nanoseconds(repeats, count, [&]() { transformMatrices(positions.data(), rotations.data(), scales.data(), matrices.data(), count); });
+		multiply = nanoseconds(repeats, count, [&]() { multiplyMatrices(left, matrices.data(), products.data(), count); });
+
+		printf("%-8s %10.2f %10.2f\n", set, transform, multiply);
+	}
+
+	return 0;
+}
\ No newline at end of file
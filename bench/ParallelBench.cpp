@@ -0,0 +1,110 @@
+#include <SimpleEngine.hpp>
+
+#include <cstdio>
+#include <cstdlib>
+#include <chrono>
+#include <cmath>
+#include <thread>
+#include <vector>
+#include <algorithm>
+
+// times parallelEach over the same entities from one thread up to one per core
+
+class BenchSystem : public SimpleEngine<BenchSystem, 32>::BaseSystem {};
+
+struct Position {
+	float x, y, z;
+};
+
+struct Velocity {
+	float x, y, z;
+};
+
+// packed, so a pass walks the dense slots instead of every entity
+struct Spin {
+	float angle, speed;
+};
+
+template <>
+struct ComponentPool<Spin> {
+	using type = SparsePool<Spin>;
+};
+
+template <typename T>
+double seconds(uint32_t repeats, const T& lambda) {
+	// once untimed, so pages are committed and threads are awake
+	lambda();
+
+	auto start = std::chrono::steady_clock::now();
+
+	for (uint32_t i = 0; i < repeats; i++)
+		lambda();
+
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() / repeats;
+}
+
+int main(int argc, char** argv) {
+	const uint32_t count = 1 << 20;
+	const uint32_t repeats = 20;
+
+	BenchSystem::Engine engine(1024 * 1024);
+
+	std::vector<uint64_t> ids(count);
+	engine.createEntities(count, ids.data());
+
+	engine.addComponents<Position>(ids.data(), count, Position{ 0.f, 0.f, 0.f });
+	engine.addComponents<Velocity>(ids.data(), count, Velocity{ 1.f, 2.f, 3.f });
+
+	// every other entity spins
+	std::vector<uint64_t> spinning;
+
+	for (uint32_t i = 0; i < count; i += 2)
+		spinning.push_back(ids[i]);
+
+	engine.addComponents<Spin>(spinning.data(), static_cast<uint32_t>(spinning.size()), Spin{ 0.f, 1.f });
+
+	// a little more work per entity than a single add, so the pass isn't only memory bound
+	auto move = [](uint64_t, Position& position, const Velocity& velocity) {
+		position.x += velocity.x * 0.016f + std::sin(position.y) * 0.001f;
+		position.y += velocity.y * 0.016f + std::sin(position.z) * 0.001f;
+		position.z += velocity.z * 0.016f + std::sin(position.x) * 0.001f;
+	};
+
+	auto spin = [](uint64_t, Spin& spin, Position& position) {
+		spin.angle = std::fmod(spin.angle + spin.speed * 0.016f, 6.2831853f);
+		position.x += std::cos(spin.angle) * 0.01f;
+	};
+
+	// positions feed back into the move, so they're reset before each timing to give every run the same work
+	auto reset = [&]() {
+		engine.each<Position>([](uint64_t, Position& position) {
+			position = { 0.f, 0.f, 0.f };
+		});
+	};
+
+	// up to one thread per core, or as many as given
+	const uint32_t cores = std::max(std::thread::hardware_concurrency(), 1u);
+	const uint32_t most = argc > 1 ? static_cast<uint32_t>(std::max(atoi(argv[1]), 1)) : cores;
+
+	printf("%u entities, %u cores\n", count, cores);
+
+	reset();
+	double single = seconds(repeats, [&]() { engine.each<Position, const Velocity>(move); });
+	reset();
+	double singleSpin = seconds(repeats, [&]() { engine.each<Spin, Position>(spin); });
+
+	printf("each: move %.2f ms, spin %.2f ms\n", single * 1e3, singleSpin * 1e3);
+
+	for (uint32_t threads = 1; threads <= most; threads++) {
+		engine.threads(threads);
+
+		reset();
+		double parallel = seconds(repeats, [&]() { engine.parallelEach<Position, const Velocity>(move); });
+		reset();
+		double parallelSpin = seconds(repeats, [&]() { engine.parallelEach<Spin, Position>(spin); });
+
+		printf("%u threads: move %.2f ms (%.2fx), spin %.2f ms (%.2fx)\n", threads, parallel * 1e3, single / parallel, parallelSpin * 1e3, singleSpin / parallelSpin);
+	}
+
+	return 0;
+}
\ No newline at end of file
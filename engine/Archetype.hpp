@@ -0,0 +1,559 @@
+#pragma once
+
+#include "ObjectPool.hpp"
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstddef>
+#include <cstring>
+#include <cassert>
+#include <utility>
+#include <vector>
+#include <algorithm>
+#include <type_traits>
+
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
+// entities with the same archetype stored components, in chunks of a power of two rows with a column per component
+class Archetype {
+public:
+	struct Column {
+		uint32_t type = 0;
+		size_t elementSize = 0;
+		size_t alignment = 0;
+		size_t offset = 0; // byte offset of column within a chunk
+
+		void(*relocate)(void* to, void* from) = nullptr; // move construct, then destruct from
+		void(*destroy)(void* element) = nullptr;
+	};
+
+	static constexpr size_t chunkSize = 16 * 1024;
+	static constexpr uint32_t none = UINT32_MAX;
+
+private:
+	std::vector<Column> _columns; // sorted by type
+	std::vector<uint32_t> _typeColumns; // type to column, none if not in archetype
+
+	uint32_t _rowShift = 0;
+	uint32_t _rowMask = 0;
+	size_t _chunkBytes = 0;
+	size_t _chunkAlignment = cacheLineSize;
+
+	std::vector<uint8_t*> _chunks;
+	std::vector<uint32_t> _indexes; // row to entity index
+	std::vector<std::vector<ChangeTicks>> _ticks; // per column, by row
+
+	std::vector<uint32_t> _addEdges; // archetype after adding a type, none if not yet found
+	std::vector<uint32_t> _removeEdges; // archetype after removing a type, none if not yet found
+
+public:
+	inline Archetype(uint32_t width, const std::vector<Column>& columns);
+
+	inline ~Archetype();
+
+	inline uint32_t column(uint32_t type) const;
+
+	inline bool has(uint32_t type) const;
+
+	inline const std::vector<Column>& columns() const;
+
+	inline void* get(uint32_t row, uint32_t column);
+
+	template <typename T>
+	inline T* get(uint32_t row, uint32_t column);
+
+	inline ChangeTicks* ticks(uint32_t row, uint32_t column);
+
+	inline uint32_t push(uint32_t index);
+
+	inline void pop(uint32_t row);
+
+	// frees chunks past the last row, emptied chunks are otherwise kept for reuse
+	inline void shrinkToFit();
+
+	inline uint32_t size() const;
+
+	inline const std::vector<uint32_t>& indexes() const;
+
+	inline uint32_t& addEdge(uint32_t type);
+
+	inline uint32_t& removeEdge(uint32_t type);
+};
+
+// Owns every archetype, and tracks which archetype and row each entity index is in.
+class ArchetypeTable {
+	struct Location {
+		uint32_t archetype = 0; // 0 being the empty archetype, which holds no rows
+		uint32_t row = 0;
+	};
+
+	const uint32_t _width;
+
+	std::vector<Archetype*> _archetypes;
+	std::vector<Location> _locations;
+
+	std::vector<Archetype::Column> _types;
+
+	inline uint32_t _transition(uint32_t from, uint32_t type, bool add);
+
+	inline void _move(uint32_t index, uint32_t to);
+
+public:
+	inline ArchetypeTable(uint32_t width);
+
+	inline ~ArchetypeTable();
+
+	template <typename T>
+	inline void registerType(uint32_t type);
+
+	inline void* add(uint32_t index, uint32_t type);
+
+	inline void remove(uint32_t index, uint32_t type);
+
+	inline void* get(uint32_t index, uint32_t type);
+
+	inline ChangeTicks* ticks(uint32_t index, uint32_t type);
+
+	inline void shrinkToFit();
+
+	inline uint32_t archetypeCount() const;
+
+	inline Archetype& archetype(uint32_t i);
+};
+
+// forwards to the archetype table, specialise ComponentPool with it to store a type in archetypes
+template <typename T>
+class ArchetypePool : public BasePool {
+	ArchetypeTable& _table;
+	const uint32_t _type;
+
+public:
+	inline ArchetypePool(ArchetypeTable& table, uint32_t type);
+
+	inline T* get(uint32_t index);
+
+	inline ChangeTicks* ticks(uint32_t index);
+
+	template <typename ...Ts>
+	inline void insert(uint32_t index, Ts&&... args);
+
+	template <typename ...Ts>
+	inline void insertBatch(const uint32_t* indexes, uint32_t count, const Ts&... args);
+
+	// copies in count trivially copyable components, the nth going to indexes[n]
+	inline void load(const uint32_t* indexes, uint32_t count, const void* components);
+
+	inline void erase(uint32_t index) override;
+
+	inline uint32_t type() const;
+};
+
+inline void* alignedAlloc(size_t size, size_t alignment) {
+#ifdef _WIN32
+	return _aligned_malloc(size, alignment);
+#else
+	return aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment);
+#endif
+}
+
+inline void alignedFree(void* memory) {
+#ifdef _WIN32
+	_aligned_free(memory);
+#else
+	free(memory);
+#endif
+}
+
+template <typename T>
+inline void relocateElement(void* to, void* from) {
+	new(to) T(std::move(*static_cast<T*>(from)));
+	static_cast<T*>(from)->~T();
+}
+
+template <typename T>
+inline void destroyElement(void* element) {
+	static_cast<T*>(element)->~T();
+}
+
+Archetype::Archetype(uint32_t width, const std::vector<Column>& columns) : _columns(columns), _typeColumns(width, none), _ticks(columns.size()), _addEdges(width, none), _removeEdges(width, none) {
+	size_t rowSize = 0;
+
+	for (uint32_t i = 0; i < _columns.size(); i++) {
+		_typeColumns[_columns[i].type] = i;
+		rowSize += _columns[i].elementSize;
+	}
+
+	if (!rowSize)
+		return;
+
+	size_t padding = 0;
+
+	for (const Column& column : _columns) {
+		_chunkAlignment = std::max(_chunkAlignment, column.alignment);
+		padding += std::max(cacheLineSize, column.alignment);
+	}
+
+	// largest power of two amount of rows fitting in a chunk alongside column padding, at least one
+	size_t usable = chunkSize > padding ? chunkSize - padding : 0;
+	uint32_t rows = 1;
+
+	while (rows * 2 * rowSize <= usable)
+		rows *= 2;
+
+	while (rows > 1 && rows * rowSize > usable)
+		rows /= 2;
+
+	while ((1u << _rowShift) < rows)
+		_rowShift++;
+
+	_rowMask = rows - 1;
+
+	// lay columns out one after the other, each starting on a cache line so they can be loaded aligned
+	for (Column& column : _columns) {
+		size_t alignment = std::max(cacheLineSize, column.alignment);
+
+		_chunkBytes = (_chunkBytes + alignment - 1) / alignment * alignment;
+		column.offset = _chunkBytes;
+		_chunkBytes += column.elementSize * rows;
+	}
+}
+
+Archetype::~Archetype() {
+	for (uint8_t* chunk : _chunks)
+		alignedFree(chunk);
+}
+
+uint32_t Archetype::column(uint32_t type) const {
+	assert(type < _typeColumns.size());
+	return _typeColumns[type];
+}
+
+bool Archetype::has(uint32_t type) const {
+	return column(type) != none;
+}
+
+const std::vector<Archetype::Column>& Archetype::columns() const {
+	return _columns;
+}
+
+void* Archetype::get(uint32_t row, uint32_t column) {
+	assert(row < _indexes.size() && column < _columns.size());
+
+	const Column& c = _columns[column];
+
+	return _chunks[row >> _rowShift] + c.offset + (row & _rowMask) * c.elementSize;
+}
+
+template <typename T>
+T* Archetype::get(uint32_t row, uint32_t column) {
+	assert(_columns[column].elementSize == sizeof(T));
+
+	return static_cast<T*>(get(row, column));
+}
+
+ChangeTicks* Archetype::ticks(uint32_t row, uint32_t column) {
+	assert(row < _indexes.size() && column < _columns.size());
+
+	return &_ticks[column][row];
+}
+
+uint32_t Archetype::push(uint32_t index) {
+	assert(_indexes.size() < UINT32_MAX);
+	uint32_t row = static_cast<uint32_t>(_indexes.size());
+
+	if ((row >> _rowShift) >= _chunks.size()) {
+		_chunks.push_back(static_cast<uint8_t*>(alignedAlloc(_chunkBytes, _chunkAlignment)));
+		assert(*_chunks.rbegin());
+	}
+
+	_indexes.push_back(index);
+
+	for (std::vector<ChangeTicks>& ticks : _ticks)
+		ticks.emplace_back();
+
+	return row;
+}
+
+void Archetype::pop(uint32_t row) {
+	assert(row < _indexes.size());
+	uint32_t last = static_cast<uint32_t>(_indexes.size() - 1);
+
+	// move last row into the gap, row's elements must already be destroyed or relocated
+	if (row != last) {
+		for (uint32_t i = 0; i < _columns.size(); i++) {
+			_columns[i].relocate(get(row, i), get(last, i));
+			_ticks[i][row] = _ticks[i][last];
+		}
+
+		_indexes[row] = _indexes[last];
+	}
+
+	_indexes.pop_back();
+
+	for (std::vector<ChangeTicks>& ticks : _ticks)
+		ticks.pop_back();
+}
+
+void Archetype::shrinkToFit() {
+	size_t used = (_indexes.size() + _rowMask) >> _rowShift;
+
+	for (size_t i = used; i < _chunks.size(); i++)
+		alignedFree(_chunks[i]);
+
+	_chunks.resize(used);
+	_chunks.shrink_to_fit();
+	_indexes.shrink_to_fit();
+
+	for (std::vector<ChangeTicks>& ticks : _ticks)
+		ticks.shrink_to_fit();
+}
+
+uint32_t Archetype::size() const {
+	return static_cast<uint32_t>(_indexes.size());
+}
+
+const std::vector<uint32_t>& Archetype::indexes() const {
+	return _indexes;
+}
+
+uint32_t& Archetype::addEdge(uint32_t type) {
+	return _addEdges[type];
+}
+
+uint32_t& Archetype::removeEdge(uint32_t type) {
+	return _removeEdges[type];
+}
+
+ArchetypeTable::ArchetypeTable(uint32_t width) : _width(width), _types(width) {
+	_archetypes.push_back(new Archetype(_width, {}));
+}
+
+ArchetypeTable::~ArchetypeTable() {
+	for (Archetype* archetype : _archetypes)
+		delete archetype;
+}
+
+uint32_t ArchetypeTable::_transition(uint32_t from, uint32_t type, bool add) {
+	uint32_t& edge = add ? _archetypes[from]->addEdge(type) : _archetypes[from]->removeEdge(type);
+
+	if (edge != Archetype::none)
+		return edge;
+
+	// build column list of the destination, kept sorted by type
+	std::vector<Archetype::Column> columns;
+
+	for (const Archetype::Column& column : _archetypes[from]->columns()) {
+		if (add && type < column.type && (columns.empty() || columns.rbegin()->type < type))
+			columns.push_back(_types[type]);
+
+		if (add || column.type != type)
+			columns.push_back(column);
+	}
+
+	if (add && (columns.empty() || columns.rbegin()->type < type))
+		columns.push_back(_types[type]);
+
+	// find existing archetype with the same columns, or make one
+	uint32_t to = Archetype::none;
+
+	for (uint32_t i = 0; i < _archetypes.size() && to == Archetype::none; i++) {
+		const std::vector<Archetype::Column>& other = _archetypes[i]->columns();
+
+		if (other.size() != columns.size())
+			continue;
+
+		bool same = true;
+
+		for (uint32_t j = 0; j < columns.size() && same; j++)
+			same = other[j].type == columns[j].type;
+
+		if (same)
+			to = i;
+	}
+
+	if (to == Archetype::none) {
+		assert(_archetypes.size() < UINT32_MAX);
+		to = static_cast<uint32_t>(_archetypes.size());
+		_archetypes.push_back(new Archetype(_width, columns));
+	}
+
+	edge = to;
+
+	return to;
+}
+
+void ArchetypeTable::_move(uint32_t index, uint32_t to) {
+	Location& location = _locations[index];
+
+	Archetype& source = *_archetypes[location.archetype];
+	Archetype& destination = *_archetypes[to];
+
+	uint32_t row = 0;
+
+	if (to)
+		row = destination.push(index);
+
+	if (location.archetype) {
+		// relocate elements both archetypes share, others are already destroyed, or yet to be constructed
+		for (uint32_t i = 0; i < source.columns().size(); i++) {
+			uint32_t column = destination.column(source.columns()[i].type);
+
+			if (column != Archetype::none) {
+				source.columns()[i].relocate(destination.get(row, column), source.get(location.row, i));
+				*destination.ticks(row, column) = *source.ticks(location.row, i);
+			}
+		}
+
+		// fill the gap left in the source, and update whichever entity was moved into it
+		uint32_t last = source.size() - 1;
+
+		if (location.row != last)
+			_locations[source.indexes()[last]].row = location.row;
+
+		source.pop(location.row);
+	}
+
+	location.archetype = to;
+	location.row = row;
+}
+
+template <typename T>
+void ArchetypeTable::registerType(uint32_t type) {
+	assert(type < _width);
+
+	Archetype::Column& column = _types[type];
+
+	column.type = type;
+	column.elementSize = sizeof(T);
+	column.alignment = alignof(T);
+	column.relocate = &relocateElement<T>;
+	column.destroy = &destroyElement<T>;
+}
+
+void* ArchetypeTable::add(uint32_t index, uint32_t type) {
+	if (index >= _locations.size())
+		_locations.resize(index + 1);
+
+	assert(_types[type].elementSize); // sanity
+	assert(!_archetypes[_locations[index].archetype]->has(type)); // sanity
+
+	_move(index, _transition(_locations[index].archetype, type, true));
+
+	const Location& location = _locations[index];
+	Archetype& archetype = *_archetypes[location.archetype];
+
+	// returns memory for the caller to construct into
+	return archetype.get(location.row, archetype.column(type));
+}
+
+void ArchetypeTable::remove(uint32_t index, uint32_t type) {
+	assert(index < _locations.size());
+
+	const Location& location = _locations[index];
+	Archetype& archetype = *_archetypes[location.archetype];
+
+	uint32_t column = archetype.column(type);
+	assert(column != Archetype::none); // sanity
+
+	// destroy in place first, so the table is consistent if the destructor uses the engine
+	archetype.columns()[column].destroy(archetype.get(location.row, column));
+
+	_move(index, _transition(location.archetype, type, false));
+}
+
+void* ArchetypeTable::get(uint32_t index, uint32_t type) {
+	assert(index < _locations.size());
+
+	const Location& location = _locations[index];
+	Archetype& archetype = *_archetypes[location.archetype];
+
+	assert(archetype.has(type)); // sanity
+
+	return archetype.get(location.row, archetype.column(type));
+}
+
+ChangeTicks* ArchetypeTable::ticks(uint32_t index, uint32_t type) {
+	assert(index < _locations.size());
+
+	const Location& location = _locations[index];
+	Archetype& archetype = *_archetypes[location.archetype];
+
+	assert(archetype.has(type)); // sanity
+
+	return archetype.ticks(location.row, archetype.column(type));
+}
+
+void ArchetypeTable::shrinkToFit() {
+	for (Archetype* archetype : _archetypes)
+		archetype->shrinkToFit();
+
+	_locations.shrink_to_fit();
+}
+
+uint32_t ArchetypeTable::archetypeCount() const {
+	return static_cast<uint32_t>(_archetypes.size());
+}
+
+Archetype& ArchetypeTable::archetype(uint32_t i) {
+	assert(i < _archetypes.size());
+	return *_archetypes[i];
+}
+
+template <typename T>
+ArchetypePool<T>::ArchetypePool(ArchetypeTable& table, uint32_t type) : _table(table), _type(type) {
+	_table.registerType<T>(_type);
+}
+
+template <typename T>
+T* ArchetypePool<T>::get(uint32_t index) {
+	return static_cast<T*>(_table.get(index, _type));
+}
+
+template <typename T>
+ChangeTicks* ArchetypePool<T>::ticks(uint32_t index) {
+	return _table.ticks(index, _type);
+}
+
+template <typename T>
+template <typename ...Ts>
+void ArchetypePool<T>::insert(uint32_t index, Ts&&... args) {
+	new(_table.add(index, _type)) T(std::forward<Ts>(args)...);
+}
+
+template <typename T>
+template <typename ...Ts>
+void ArchetypePool<T>::insertBatch(const uint32_t* indexes, uint32_t count, const Ts&... args) {
+	// each entity still moves on its own, trivially copyable types are constructed once
+	if constexpr (std::is_trivially_copyable<T>::value) {
+		const T element = T(args...);
+
+		for (uint32_t i = 0; i < count; i++)
+			memcpy(_table.add(indexes[i], _type), &element, sizeof(T));
+	}
+	else {
+		for (uint32_t i = 0; i < count; i++)
+			new(_table.add(indexes[i], _type)) T(args...);
+	}
+}
+
+template <typename T>
+void ArchetypePool<T>::load(const uint32_t* indexes, uint32_t count, const void* components) {
+	static_assert(std::is_trivially_copyable<T>::value);
+
+	const uint8_t* source = static_cast<const uint8_t*>(components);
+
+	for (uint32_t i = 0; i < count; i++)
+		memcpy(_table.add(indexes[i], _type), source + i * sizeof(T), sizeof(T));
+}
+
+template <typename T>
+void ArchetypePool<T>::erase(uint32_t index) {
+	_table.remove(index, _type);
+}
+
+template <typename T>
+uint32_t ArchetypePool<T>::type() const {
+	return _type;
+}
\ No newline at end of file
@@ -0,0 +1,192 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstddef>
+#include <cassert>
+#include <vector>
+#include <string>
+#include <algorithm>
+
+// bump allocator for memory only needed until reset, blocks are kept and merged so steady frames don't use the heap
+class FrameArena {
+	struct Block {
+		uint8_t* memory = nullptr;
+		size_t size = 0;
+	};
+
+	const size_t _blockSize;
+
+	std::vector<Block> _blocks;
+	size_t _block = 0; // block being allocated from
+	size_t _offset = 0; // into that block
+
+	size_t _used = 0; // bytes handed out since reset, including alignment
+	uint64_t _heapAllocations = 0;
+
+	inline void _addBlock(size_t size);
+
+public:
+	inline FrameArena(size_t blockSize = 64 * 1024);
+
+	inline ~FrameArena();
+
+	FrameArena(const FrameArena&) = delete;
+
+	FrameArena& operator=(const FrameArena&) = delete;
+
+	inline void* allocate(size_t size, size_t alignment = alignof(std::max_align_t));
+
+	template <typename T>
+	inline T* allocate(size_t count);
+
+	// invalidates everything allocated since the last reset
+	inline void reset();
+
+	inline size_t used() const;
+
+	// blocks allocated from the heap so far, stops rising once frames are steady
+	inline uint64_t heapAllocations() const;
+};
+
+// STL allocator onto a frame arena, deallocating does nothing
+template <typename T>
+class FrameAllocator {
+	template <typename T1>
+	friend class FrameAllocator;
+
+	FrameArena* _arena;
+
+public:
+	using value_type = T;
+
+	inline FrameAllocator(FrameArena& arena);
+
+	template <typename T1>
+	inline FrameAllocator(const FrameAllocator<T1>& other);
+
+	inline T* allocate(size_t count);
+
+	inline void deallocate(T* memory, size_t count);
+
+	template <typename T1>
+	inline bool operator==(const FrameAllocator<T1>& other) const;
+
+	template <typename T1>
+	inline bool operator!=(const FrameAllocator<T1>& other) const;
+};
+
+template <typename T>
+using FrameVector = std::vector<T, FrameAllocator<T>>;
+
+using FrameString = std::basic_string<char, std::char_traits<char>, FrameAllocator<char>>;
+
+FrameArena::FrameArena(size_t blockSize) : _blockSize(blockSize) {}
+
+FrameArena::~FrameArena() {
+	for (Block& block : _blocks)
+		free(block.memory);
+}
+
+void FrameArena::_addBlock(size_t size) {
+	Block block;
+
+	block.memory = static_cast<uint8_t*>(malloc(size));
+	block.size = size;
+
+	assert(block.memory);
+
+	_blocks.push_back(block);
+	_heapAllocations++;
+}
+
+void* FrameArena::allocate(size_t size, size_t alignment) {
+	assert(alignment && !(alignment & (alignment - 1)));
+
+	while (true) {
+		if (_block < _blocks.size()) {
+			Block& block = _blocks[_block];
+
+			uintptr_t address = reinterpret_cast<uintptr_t>(block.memory) + _offset;
+			size_t padding = (alignment - address % alignment) % alignment;
+
+			if (_offset + padding + size <= block.size) {
+				_offset += padding + size;
+				_used += padding + size;
+
+				return reinterpret_cast<void*>(address + padding);
+			}
+
+			// doesn't fit, move on to the next block
+			if (_block + 1 < _blocks.size()) {
+				_block++;
+				_offset = 0;
+				continue;
+			}
+		}
+
+		_addBlock(std::max(_blockSize, size + alignment));
+
+		_block = _blocks.size() - 1;
+		_offset = 0;
+	}
+}
+
+template <typename T>
+T* FrameArena::allocate(size_t count) {
+	return static_cast<T*>(allocate(sizeof(T) * count, alignof(T)));
+}
+
+void FrameArena::reset() {
+	// merge blocks into one which fits the whole frame, so next frame doesn't need more
+	if (_blocks.size() > 1) {
+		size_t size = 0;
+
+		for (Block& block : _blocks) {
+			size += block.size;
+			free(block.memory);
+		}
+
+		_blocks.clear();
+		_addBlock(size);
+	}
+
+	_block = 0;
+	_offset = 0;
+	_used = 0;
+}
+
+size_t FrameArena::used() const {
+	return _used;
+}
+
+uint64_t FrameArena::heapAllocations() const {
+	return _heapAllocations;
+}
+
+template <typename T>
+FrameAllocator<T>::FrameAllocator(FrameArena& arena) : _arena(&arena) {}
+
+template <typename T>
+template <typename T1>
+FrameAllocator<T>::FrameAllocator(const FrameAllocator<T1>& other) : _arena(other._arena) {}
+
+template <typename T>
+T* FrameAllocator<T>::allocate(size_t count) {
+	return _arena->allocate<T>(count);
+}
+
+template <typename T>
+void FrameAllocator<T>::deallocate(T*, size_t) {}
+
+template <typename T>
+template <typename T1>
+bool FrameAllocator<T>::operator==(const FrameAllocator<T1>& other) const {
+	return _arena == other._arena;
+}
+
+template <typename T>
+template <typename T1>
+bool FrameAllocator<T>::operator!=(const FrameAllocator<T1>& other) const {
+	return _arena != other._arena;
+}
\ No newline at end of file
@@ -0,0 +1,210 @@
+#pragma once
+
+#include <cstdint>
+#include <cassert>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <deque>
+#include <vector>
+#include <functional>
+
+// work stealing thread pool, the calling thread works as worker 0 until every job is done
+class JobPool {
+	struct Queue {
+		std::mutex mutex;
+		std::deque<uint32_t> jobs;
+	};
+
+	std::vector<std::thread> _threads;
+	std::vector<Queue*> _queues;
+
+	std::mutex _mutex;
+	std::condition_variable _wake;
+	uint64_t _generation = 0;
+	bool _stopping = false;
+
+	std::atomic<uint32_t> _remaining;
+	const std::function<void(uint32_t, uint32_t)>* _function = nullptr;
+
+	inline static thread_local uint32_t _worker = 0;
+
+	inline bool _pop(uint32_t queue, bool back, uint32_t* job);
+
+	inline bool _runOne(uint32_t worker);
+
+	inline void _work(uint32_t worker);
+
+	inline void _stop();
+
+public:
+	inline JobPool();
+
+	inline ~JobPool();
+
+	inline void resize(uint32_t workers);
+
+	inline uint32_t size() const;
+
+	inline static uint32_t worker();
+
+	inline void run(uint32_t jobs, const std::function<void(uint32_t job, uint32_t worker)>& function);
+};
+
+JobPool::JobPool() : _remaining(0) {
+	_queues.push_back(new Queue());
+}
+
+JobPool::~JobPool() {
+	_stop();
+
+	for (Queue* queue : _queues)
+		delete queue;
+}
+
+bool JobPool::_pop(uint32_t queue, bool back, uint32_t* job) {
+	std::lock_guard<std::mutex> lock(_queues[queue]->mutex);
+
+	std::deque<uint32_t>& jobs = _queues[queue]->jobs;
+
+	if (jobs.empty())
+		return false;
+
+	if (back) {
+		*job = jobs.back();
+		jobs.pop_back();
+	}
+	else {
+		*job = jobs.front();
+		jobs.pop_front();
+	}
+
+	return true;
+}
+
+bool JobPool::_runOne(uint32_t worker) {
+	uint32_t job;
+	bool found = _pop(worker, true, &job);
+
+	// steal from others if own queue is empty
+	for (uint32_t i = 1; i < _queues.size() && !found; i++)
+		found = _pop((worker + i) % _queues.size(), false, &job);
+
+	if (!found)
+		return false;
+
+	(*_function)(job, worker);
+
+	_remaining.fetch_sub(1, std::memory_order_release);
+	return true;
+}
+
+void JobPool::_work(uint32_t worker) {
+	_worker = worker;
+
+	uint64_t generation = 0;
+
+	while (true) {
+		{
+			std::unique_lock<std::mutex> lock(_mutex);
+			_wake.wait(lock, [&] { return _stopping || _generation != generation; });
+
+			if (_stopping)
+				return;
+
+			generation = _generation;
+		}
+
+		while (_runOne(worker));
+	}
+}
+
+void JobPool::_stop() {
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_stopping = true;
+	}
+
+	_wake.notify_all();
+
+	for (std::thread& thread : _threads)
+		thread.join();
+
+	_threads.clear();
+	_stopping = false;
+}
+
+void JobPool::resize(uint32_t workers) {
+	assert(_worker == 0 && !_remaining.load()); // not while running
+
+	if (!workers)
+		workers = 1;
+
+	_stop();
+
+	while (_queues.size() > workers) {
+		delete _queues.back();
+		_queues.pop_back();
+	}
+
+	while (_queues.size() < workers)
+		_queues.push_back(new Queue());
+
+	for (uint32_t i = 1; i < workers; i++)
+		_threads.emplace_back(&JobPool::_work, this, i);
+}
+
+uint32_t JobPool::size() const {
+	return static_cast<uint32_t>(_queues.size());
+}
+
+uint32_t JobPool::worker() {
+	return _worker;
+}
+
+void JobPool::run(uint32_t jobs, const std::function<void(uint32_t job, uint32_t worker)>& function) {
+	assert(_worker == 0 && !_remaining.load()); // not recursively
+
+	if (!jobs)
+		return;
+
+	// nothing to share, so run on calling thread
+	if (_queues.size() == 1 || jobs == 1) {
+		for (uint32_t i = 0; i < jobs; i++)
+			function(i, 0);
+
+		return;
+	}
+
+	_function = &function;
+	_remaining.store(jobs, std::memory_order_relaxed);
+
+	// split jobs into even contiguous runs per worker
+	uint32_t workers = static_cast<uint32_t>(_queues.size());
+
+	for (uint32_t i = 0; i < workers; i++) {
+		std::lock_guard<std::mutex> lock(_queues[i]->mutex);
+
+		uint32_t begin = static_cast<uint32_t>(static_cast<uint64_t>(jobs) * i / workers);
+		uint32_t end = static_cast<uint32_t>(static_cast<uint64_t>(jobs) * (i + 1) / workers);
+
+		for (uint32_t job = begin; job < end; job++)
+			_queues[i]->jobs.push_back(job);
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_generation++;
+	}
+
+	_wake.notify_all();
+
+	// work until every job is done, including ones still running on other workers
+	while (_remaining.load(std::memory_order_acquire)) {
+		if (!_runOne(0))
+			std::this_thread::yield();
+	}
+
+	_function = nullptr;
+}
\ No newline at end of file
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+// Read only view of a whole file mapped into memory, unmapped when destroyed.
+class MappedFile {
+	const uint8_t* _data = nullptr;
+	size_t _size = 0;
+
+#ifdef _WIN32
+	HANDLE _file = INVALID_HANDLE_VALUE;
+	HANDLE _mapping = nullptr;
+#else
+	int _file = -1;
+#endif
+
+public:
+	inline MappedFile(const std::string& path);
+
+	inline ~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	inline bool valid() const;
+
+	inline const uint8_t* data() const;
+
+	inline size_t size() const;
+};
+
+#ifdef _WIN32
+MappedFile::MappedFile(const std::string& path) {
+	_file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+
+	if (_file == INVALID_HANDLE_VALUE)
+		return;
+
+	LARGE_INTEGER size;
+
+	if (!GetFileSizeEx(_file, &size) || !size.QuadPart)
+		return;
+
+	_mapping = CreateFileMappingA(_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+
+	if (!_mapping)
+		return;
+
+	_data = static_cast<const uint8_t*>(MapViewOfFile(_mapping, FILE_MAP_READ, 0, 0, 0));
+
+	if (_data)
+		_size = static_cast<size_t>(size.QuadPart);
+}
+
+MappedFile::~MappedFile() {
+	if (_data)
+		UnmapViewOfFile(_data);
+
+	if (_mapping)
+		CloseHandle(_mapping);
+
+	if (_file != INVALID_HANDLE_VALUE)
+		CloseHandle(_file);
+}
+#else
+MappedFile::MappedFile(const std::string& path) {
+	_file = open(path.c_str(), O_RDONLY);
+
+	if (_file == -1)
+		return;
+
+	struct stat info;
+
+	if (fstat(_file, &info) || !info.st_size)
+		return;
+
+	void* data = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, _file, 0);
+
+	if (data == MAP_FAILED)
+		return;
+
+	// read front to back once
+	madvise(data, static_cast<size_t>(info.st_size), MADV_SEQUENTIAL);
+
+	_data = static_cast<const uint8_t*>(data);
+	_size = static_cast<size_t>(info.st_size);
+}
+
+MappedFile::~MappedFile() {
+	if (_data)
+		munmap(const_cast<uint8_t*>(_data), _size);
+
+	if (_file != -1)
+		close(_file);
+}
+#endif
+
+bool MappedFile::valid() const {
+	return _data != nullptr;
+}
+
+const uint8_t* MappedFile::data() const {
+	return _data;
+}
+
+size_t MappedFile::size() const {
+	return _size;
+}
\ No newline at end of file
@@ -1,112 +1,427 @@
 #pragma once
 
+#include "VirtualMemory.hpp"
+
 #include <cstdint>
 #include <cstdlib>
+#include <cstring>
 #include <cassert>
 #include <utility>
 #include <vector>
+#include <algorithm>
+#include <type_traits>
+
+// pass as a pool's alignment so elements don't share cache lines
+constexpr size_t cacheLineSize = 64;
+
+// engine ticks a component was added and last changed at, kept by pools beside their components
+struct ChangeTicks {
+	uint32_t added = 0;
+	uint32_t changed = 0;
+};
 
 class BasePool {
+public:
+	inline virtual ~BasePool() {}
+
+	virtual inline void erase(uint32_t index) = 0;
+
+	// most bytes of emptied memory kept for reuse, past which it's given back to the OS
+	virtual inline void highWater(size_t) {}
+
+	// gives back all memory not holding live components
+	virtual inline void shrinkToFit() {}
+};
+
+// elements by index in address space reserved up front, committed as reached, empty blocks kept up to the high water mark
+class ChunkPool : public BasePool {
+public:
+	static constexpr size_t blockSize = 64 * 1024;
+
 protected:
-	const size_t _chunkSize;
+	static constexpr uint32_t _none = UINT32_MAX;
+
+	struct Block {
+		uint32_t live = 0; // elements overlapping the block
+		uint32_t empty = _none; // position in empty blocks, none if not in it
+	};
+
+	const size_t _chunkSize; // most committed at once
 	const size_t _elementSize;
+	const size_t _stride; // element size padded to alignment
+
+	uint8_t* _memory = nullptr;
+	size_t _reserved = 0; // bytes
+	size_t _committed = 0; // bytes
+	uint32_t _count = 0; // elements fitting in what's committed
 
-	std::vector<uint8_t*> _chunks;
+	size_t _highWater = 16 * blockSize;
+
+	std::vector<Block> _blocks;
+	std::vector<uint32_t> _emptyBlocks; // resident blocks with no live elements
+
+	// per element, in their own range, committed with the elements'
+	uint8_t* _ticks = nullptr;
+	size_t _ticksReserved = 0; // bytes
+	size_t _ticksCommitted = 0; // bytes
+
+	inline void _discard(uint32_t block);
+
+	inline void _unlist(uint32_t block);
+
+	// counts count elements from first as constructed, or destroyed
+	inline void _track(uint32_t first, uint32_t count, bool live);
 
 public:
-	inline BasePool(size_t elementSize, size_t chunkSize);
+	inline ChunkPool(size_t elementSize, size_t alignment, size_t chunkSize);
+
+	inline ~ChunkPool();
 
-	inline ~BasePool();
+	ChunkPool(const ChunkPool&) = delete;
+
+	ChunkPool& operator=(const ChunkPool&) = delete;
 
 	inline void reserve(uint32_t index);
 
 	template <typename T>
 	inline T* get(uint32_t index);
 
+	inline ChangeTicks* ticks(uint32_t index);
+
 	template <typename T, typename ...Ts>
 	inline void insert(uint32_t index, Ts&&... args);
 
+	// copies element's bytes into count slots from first, or zeroes them if element is null
+	inline void fill(uint32_t first, uint32_t count, const void* element);
+
+	// copies count elements' bytes from elements into slots from first
+	inline void copy(uint32_t first, uint32_t count, const void* elements);
+
 	inline uint32_t count() const;
 
-	virtual inline void erase(uint32_t index) = 0;
+	inline void highWater(size_t bytes) override;
+
+	inline void shrinkToFit() override;
 };
 
-template <typename T>
-class ObjectPool : public BasePool {
+// alignment defaults to the type's, a larger one pads the stride
+template <typename T, size_t alignment = alignof(T)>
+class ObjectPool : public ChunkPool {
+	static_assert(alignment >= alignof(T) && !(alignment & (alignment - 1)));
+
 	template <typename T1>
 	inline void _erase(uint32_t index);
 
 public:
+	// constant, so addressing is a shift or multiply
+	static constexpr size_t stride = (sizeof(T) + alignment - 1) / alignment * alignment;
+
 	inline ObjectPool(size_t chunkSize);
 
+	inline T* get(uint32_t index);
+
+	template <typename ...Ts>
+	inline void insert(uint32_t index, Ts&&... args);
+
+	template <typename ...Ts>
+	inline void insertBatch(const uint32_t* indexes, uint32_t count, const Ts&... args);
+
+	// copies in count trivially copyable components, the nth going to indexes[n]
+	inline void load(const uint32_t* indexes, uint32_t count, const void* components);
+
 	inline void erase(uint32_t index) override;
 };
 
-BasePool::BasePool(size_t elementSize, size_t chunkSize) : _elementSize(elementSize), _chunkSize(chunkSize) {}
+ChunkPool::ChunkPool(size_t elementSize, size_t alignment, size_t chunkSize) : _chunkSize(chunkSize), _elementSize(elementSize), _stride((elementSize + alignment - 1) / alignment * alignment) {
+	// the range starts on a page, so elements are aligned as long as the stride is
+	assert(alignment && !(alignment & (alignment - 1)) && alignment <= pageSize());
+
+	// enough for every index at its stride, within what's sensible to hold in address space per pool
+	const size_t limit = sizeof(void*) >= 8 ? size_t(1) << 38 : size_t(1) << 26;
+
+	_reserved = pageAlign(static_cast<size_t>(std::min<uint64_t>((uint64_t(UINT32_MAX) + 1) * _stride, limit)));
+	_memory = reserveMemory(_reserved);
+
+	_ticksReserved = pageAlign(_reserved / _stride * sizeof(ChangeTicks));
+	_ticks = reserveMemory(_ticksReserved);
 
-BasePool::~BasePool() {
-	for (uint8_t* chunk : _chunks)
-		free(chunk);
+	assert(_memory && _ticks);
+	assert(blockSize % pageSize() == 0);
 }
 
-void BasePool::reserve(uint32_t index) {
-	if (index < count())
+ChunkPool::~ChunkPool() {
+	if (_memory)
+		releaseMemory(_memory, _reserved);
+
+	if (_ticks)
+		releaseMemory(_ticks, _ticksReserved);
+}
+
+void ChunkPool::reserve(uint32_t index) {
+	if (index < _count)
 		return;
 
-	size_t elementsPerChunk = _chunkSize / _elementSize;
+	size_t needed = (static_cast<size_t>(index) + 1) * _stride;
+	assert(needed <= _reserved);
+
+	// doubles what's committed, up to a chunk
+	size_t size = std::max(needed, _committed + std::min(std::max(_committed, pageSize()), _chunkSize));
+	size = std::min(pageAlign(size), _reserved);
 
-	assert(index / elementsPerChunk <= UINT32_MAX);
-	uint32_t chunk = static_cast<uint32_t>(index / elementsPerChunk);
+	bool committed = commitMemory(_memory + _committed, size - _committed);
+	assert(committed);
 
-	size_t size = _chunks.size();
-	_chunks.resize(chunk + 1);
+	_committed = size;
+	_count = static_cast<uint32_t>(std::min<size_t>(_committed / _stride, UINT32_MAX));
 
-	for (size_t i = size; i < chunk + 1; i++) {
-		_chunks[i] = static_cast<uint8_t*>(malloc(_chunkSize));
-		assert(_chunks[i]);
+	size_t ticks = std::min(pageAlign(static_cast<size_t>(_count) * sizeof(ChangeTicks)), _ticksReserved);
+
+	if (ticks > _ticksCommitted) {
+		committed = commitMemory(_ticks + _ticksCommitted, ticks - _ticksCommitted);
+		assert(committed);
+
+		_ticksCommitted = ticks;
 	}
 }
 
 template <typename T>
-T* BasePool::get(uint32_t index) {
-	assert(index < count());
+T* ChunkPool::get(uint32_t index) {
+	assert(index < _count);
 
-	size_t elementsPerChunk = _chunkSize / _elementSize;
-
-	assert(index / elementsPerChunk <= UINT32_MAX);
-	uint32_t chunk = static_cast<uint32_t>(index / elementsPerChunk);
+	return reinterpret_cast<T*>(_memory + static_cast<size_t>(index) * _stride);
+}
 
-	size_t offset = (index - (chunk * elementsPerChunk)) * _elementSize;
+ChangeTicks* ChunkPool::ticks(uint32_t index) {
+	assert(index < _count);
 
-	return reinterpret_cast<T*>(_chunks[chunk] + offset);
+	return reinterpret_cast<ChangeTicks*>(_ticks) + index;
 }
 
 template <typename T, typename ...Ts>
-void BasePool::insert(uint32_t index, Ts&&... args) {
-	assert(sizeof(T) <= _elementSize);
+void ChunkPool::insert(uint32_t index, Ts&&... args) {
+	assert(sizeof(T) <= _elementSize && _stride % alignof(T) == 0);
 
-	if (index >= count())
+	if (index >= _count)
 		reserve(index);
 
 	new(static_cast<void*>(get<T>(index))) T(std::forward<Ts>(args)...);
+	_track(index, 1, true);
 }
 
-uint32_t BasePool::count() const {
-	size_t elementsPerChunk = _chunkSize / _elementSize;
-	assert(_chunks.size() * elementsPerChunk <= UINT32_MAX);
-	return static_cast<uint32_t>(_chunks.size() * elementsPerChunk);
+void ChunkPool::fill(uint32_t first, uint32_t count, const void* element) {
+	if (!count)
+		return;
+
+	reserve(first + count - 1);
+	_track(first, count, true);
+
+	uint8_t* begin = _memory + static_cast<size_t>(first) * _stride;
+
+	if (!element) {
+		memset(begin, 0, count * _stride);
+		return;
+	}
+
+	for (uint32_t i = 0; i < count; i++)
+		memcpy(begin + i * _stride, element, _elementSize);
 }
 
-template<typename T>
-ObjectPool<T>::ObjectPool(size_t chunkSize) : BasePool(sizeof(T), chunkSize) { }
+void ChunkPool::copy(uint32_t first, uint32_t count, const void* elements) {
+	if (!count)
+		return;
+
+	reserve(first + count - 1);
+	_track(first, count, true);
+
+	uint8_t* begin = _memory + static_cast<size_t>(first) * _stride;
+
+	if (_stride == _elementSize) {
+		memcpy(begin, elements, count * _elementSize);
+		return;
+	}
+
+	// padded, so copied one by one
+	const uint8_t* source = static_cast<const uint8_t*>(elements);
+
+	for (uint32_t i = 0; i < count; i++)
+		memcpy(begin + i * _stride, source + i * _elementSize, _elementSize);
+}
 
-template<typename T>
+void ChunkPool::_discard(uint32_t block) {
+	size_t begin = block * blockSize;
+	size_t end = std::min(begin + blockSize, _committed);
+
+	if (begin < end)
+		discardMemory(_memory + begin, end - begin);
+}
+
+void ChunkPool::_unlist(uint32_t block) {
+	uint32_t position = _blocks[block].empty;
+
+	_emptyBlocks[position] = *_emptyBlocks.rbegin();
+	_blocks[_emptyBlocks[position]].empty = position;
+
+	_emptyBlocks.pop_back();
+	_blocks[block].empty = _none;
+}
+
+void ChunkPool::_track(uint32_t first, uint32_t count, bool live) {
+	if (!count)
+		return;
+
+	size_t begin = static_cast<size_t>(first) * _stride;
+	size_t end = (static_cast<size_t>(first) + count) * _stride;
+
+	size_t last = (end - 1) / blockSize;
+
+	if (last >= _blocks.size())
+		_blocks.resize(last + 1);
+
+	for (size_t i = begin / blockSize; i <= last; i++) {
+		Block& block = _blocks[i];
+
+		// elements overlapping both the range and the block
+		size_t from = std::max(begin, i * blockSize);
+		size_t to = std::min(end, (i + 1) * blockSize);
+		uint32_t elements = static_cast<uint32_t>((to - 1) / _stride - from / _stride + 1);
+
+		if (live) {
+			if (block.empty != _none)
+				_unlist(static_cast<uint32_t>(i));
+
+			block.live += elements;
+			continue;
+		}
+
+		assert(block.live >= elements);
+		block.live -= elements;
+
+		if (block.live)
+			continue;
+
+		// keep it resident for reuse if under the high water mark
+		if ((_emptyBlocks.size() + 1) * blockSize > _highWater) {
+			_discard(static_cast<uint32_t>(i));
+			continue;
+		}
+
+		block.empty = static_cast<uint32_t>(_emptyBlocks.size());
+		_emptyBlocks.push_back(static_cast<uint32_t>(i));
+	}
+}
+
+uint32_t ChunkPool::count() const {
+	return _count;
+}
+
+void ChunkPool::highWater(size_t bytes) {
+	_highWater = bytes;
+
+	while (_emptyBlocks.size() * blockSize > _highWater) {
+		uint32_t block = *_emptyBlocks.rbegin();
+
+		_unlist(block);
+		_discard(block);
+	}
+}
+
+void ChunkPool::shrinkToFit() {
+	for (uint32_t block : _emptyBlocks) {
+		_discard(block);
+		_blocks[block].empty = _none;
+	}
+
+	_emptyBlocks.clear();
+
+	// decommit past the last block with live elements
+	size_t used = _blocks.size();
+
+	while (used && !_blocks[used - 1].live)
+		used--;
+
+	_blocks.resize(used);
+
+	size_t size = std::min(pageAlign(used * blockSize), _committed);
+
+	if (size < _committed) {
+		decommitMemory(_memory + size, _committed - size);
+		_committed = size;
+		_count = static_cast<uint32_t>(std::min<size_t>(_committed / _stride, UINT32_MAX));
+
+		size_t ticks = std::min(pageAlign(static_cast<size_t>(_count) * sizeof(ChangeTicks)), _ticksReserved);
+
+		if (ticks < _ticksCommitted) {
+			decommitMemory(_ticks + ticks, _ticksCommitted - ticks);
+			_ticksCommitted = ticks;
+		}
+	}
+}
+
+template <typename T, size_t alignment>
+ObjectPool<T, alignment>::ObjectPool(size_t chunkSize) : ChunkPool(sizeof(T), alignment, chunkSize) { }
+
+template <typename T, size_t alignment>
+T* ObjectPool<T, alignment>::get(uint32_t index) {
+	assert(index < _count);
+
+	return reinterpret_cast<T*>(_memory + static_cast<size_t>(index) * stride);
+}
+
+template <typename T, size_t alignment>
+template <typename ...Ts>
+void ObjectPool<T, alignment>::insert(uint32_t index, Ts&&... args) {
+	ChunkPool::insert<T>(index, std::forward<Ts>(args)...);
+}
+
+template <typename T, size_t alignment>
+template <typename ...Ts>
+void ObjectPool<T, alignment>::insertBatch(const uint32_t* indexes, uint32_t count, const Ts&... args) {
+	if (!count)
+		return;
+
+	if constexpr (std::is_trivially_copyable<T>::value) {
+		// construct once then copy, or zero if value initialising, a run of consecutive indexes at a time
+		const T element = T(args...);
+		const void* source = sizeof...(Ts) == 0 && std::is_trivially_default_constructible<T>::value ? nullptr : &element;
+
+		for (uint32_t i = 0, run = 1; i < count; i += run) {
+			for (run = 1; i + run < count && indexes[i + run] == indexes[i] + run; run++);
+
+			fill(indexes[i], run, source);
+		}
+	}
+	else {
+		reserve(*std::max_element(indexes, indexes + count));
+
+		for (uint32_t i = 0; i < count; i++) {
+			new(static_cast<void*>(get(indexes[i]))) T(args...);
+			_track(indexes[i], 1, true);
+		}
+	}
+}
+
+template <typename T, size_t alignment>
+void ObjectPool<T, alignment>::load(const uint32_t* indexes, uint32_t count, const void* components) {
+	static_assert(std::is_trivially_copyable<T>::value);
+
+	const uint8_t* source = static_cast<const uint8_t*>(components);
+
+	// a run of consecutive indexes at a time
+	for (uint32_t i = 0, run = 1; i < count; i += run) {
+		for (run = 1; i + run < count && indexes[i + run] == indexes[i] + run; run++);
+
+		copy(indexes[i], run, source + i * sizeof(T));
+	}
+}
+
+template <typename T, size_t alignment>
 template<typename T1>
-void ObjectPool<T>::_erase(uint32_t index) {
-	get<T>(index)->~T();
+void ObjectPool<T, alignment>::_erase(uint32_t index) {
+	get(index)->~T();
 }
 
-template <typename T>
-void ObjectPool<T>::erase(uint32_t index) {
+template <typename T, size_t alignment>
+void ObjectPool<T, alignment>::erase(uint32_t index) {
 	_erase<T>(index);
+	_track(index, 1, false);
 }
\ No newline at end of file
@@ -1,7 +1,14 @@
 #pragma once
 
 #include "TypeMask.hpp"
+#include "TypeList.hpp"
 #include "ObjectPool.hpp"
+#include "SparsePool.hpp"
+#include "TagPool.hpp"
+#include "Archetype.hpp"
+#include "JobPool.hpp"
+#include "MappedFile.hpp"
+#include "FrameArena.hpp"
 #include "Utility.hpp"
 
 #include <vector>
@@ -9,6 +16,12 @@
 #include <algorithm>
 #include <type_traits>
 #include <iostream>
+#include <functional>
+#include <tuple>
+#include <memory>
+#include <thread>
+#include <string>
+#include <fstream>
 
 #define SYSFUNC(systemInterface, systemFunction) \
 	systemInterface::Engine::BaseSystem::FunctionSpecialization<decltype(&systemInterface::systemFunction), &systemInterface::systemFunction>
@@ -16,20 +29,59 @@
 #define SYSFUNC_ENABLE(systemInterface, systemFunction, priority) \
 	SYSFUNC(systemInterface, systemFunction)::enable<std::remove_reference<decltype(*this)>::type>(priority)
 
+// systems in the Systems<...> registry are called through their own type, rather than the interface
 #define SYSFUNC_CALL(systemInterface, systemFunction, engine) \
-	engine.callSystems<SYSFUNC(systemInterface, systemFunction)>
+	engine.systemCaller<SYSFUNC(systemInterface, systemFunction)>([](auto* system, auto&... args) { \
+		system->std::remove_pointer<decltype(system)>::type::systemFunction(args...); \
+	})
 
-template <typename SystemInterface, uint32_t maxComponents>
+// Query filters, passed to each after the lambda. Ticks come from SimpleEngine::tick().
+template <typename T>
+struct Changed {
+	uint32_t since; // components added, added again, iterated mutably, or marked with markChanged, after this tick
+};
+
+template <typename T>
+struct Added {
+	uint32_t since; // components added after this tick
+};
+
+template <typename T>
+inline Changed<T> changed(uint32_t since) {
+	return { since };
+}
+
+template <typename T>
+inline Added<T> added(uint32_t since) {
+	return { since };
+}
+
+// storage policy, specialise with 'using type = SparsePool<T>', 'ArchetypePool<T>' or 'ObjectPool<T, cacheLineSize>'
+template <typename T>
+struct ComponentPool {
+	static constexpr bool tag = std::is_empty<T>::value && std::is_trivially_default_constructible<T>::value && std::is_trivially_destructible<T>::value;
+
+	using type = typename std::conditional<tag, TagPool<T>, ObjectPool<T>>::type;
+};
+
+// for saving registered types which aren't trivially copyable, specialise with saved = true and static save and load
+template <typename T>
+struct ComponentSnapshot {
+	static constexpr bool saved = false;
+};
+
+template <typename SystemInterface, uint32_t maxComponents, typename ...Registries>
 class SimpleEngine {
-	using TypeMask = TypeMask<maxComponents>;
+	// optional Components<...> and Systems<...> registries, giving listed types constant ids
+	using ComponentRegistry = typename FindRegistry<Components, Registries...>::type;
+	using SystemRegistry = typename FindRegistry<Systems, Registries...>::type;
 
-	struct Identity{ 
-		uint32_t index;
-		uint32_t version = 1;
-		TypeMask mask;
-		uint8_t flags = None;
-		uint32_t references = 0;
+	static_assert(ComponentRegistry::size <= maxComponents, "more registered components than maxComponents");
 
+	using TypeMask = TypeMask<maxComponents, ComponentRegistry>;
+
+	// identity flags, the rest of an entity's identity is split across arrays in the engine
+	struct Identity{ 
 		enum Flags : uint8_t{
 			None = 0,
 			Active = 1,
@@ -42,9 +94,30 @@ class SimpleEngine {
 		uint32_t index;
 		int32_t priority = 0;
 
+		// components read and written, if undeclared the system can't run alongside any other
+		bool declared = false;
+		TypeMask reads = {};
+		TypeMask writes = {};
+
+		bool mainThread = false; // kept on the thread calling SYSFUNC_CALL, such as for window or graphics calls
+
+		uint32_t wave = 0;
+
 		inline void operator=(const IndexPriorityPair& other) {
 			index = other.index;
 			priority = other.priority;
+			declared = other.declared;
+			reads = other.reads;
+			writes = other.writes;
+			mainThread = other.mainThread;
+			wave = other.wave;
+		}
+
+		inline bool conflicts(const IndexPriorityPair& other) const {
+			if (!declared || !other.declared)
+				return true;
+
+			return writes.overlaps(other.reads) || writes.overlaps(other.writes) || reads.overlaps(other.writes);
 		}
 
 		inline bool operator<(const IndexPriorityPair& other) {
@@ -56,6 +129,46 @@ class SimpleEngine {
 		}
 	};
 
+	// indexes of entities with all of a query's components, kept up to date as components are added and removed
+	struct QueryCache {
+		TypeMask mask;
+
+		std::vector<uint32_t> indexes;
+		std::vector<uint32_t> positions; // by entity index, position in indexes or UINT32_MAX
+
+		inline void update(uint32_t index, bool matches);
+	};
+
+	// snapshot layout, sections padded to 8 bytes, then per component type a record, indexes and components
+	static constexpr uint32_t _snapshotMagic = 0x4e534553; // "SESN"
+	static constexpr uint32_t _snapshotVersion = 2;
+
+	struct SnapshotHeader {
+		uint32_t magic;
+		uint32_t version;
+		uint32_t width; // maxComponents
+		uint32_t maskSize;
+		uint32_t entities;
+		uint32_t freeIndexes;
+		uint32_t components;
+		uint32_t padding;
+	};
+
+	struct SnapshotRecord {
+		uint32_t type;
+		uint32_t size;
+		uint32_t count;
+		uint32_t padding;
+	};
+
+	// record's sections in a mapped snapshot
+	struct SnapshotComponents {
+		const SnapshotRecord* record;
+		const uint32_t* indexes;
+		const uint32_t* offsets; // only for serialised types
+		const uint8_t* components;
+	};
+
 public:
 	class BaseSystem {
 	public:
@@ -67,17 +180,70 @@ public:
 		class FunctionSpecialization<void(T::*)(Ts...), func> {
 			static std::vector<IndexPriorityPair> _systemIndexes;
 
+			static std::vector<uint32_t> _scheduled; // systems ordered by wave, then main thread ones first, then priority
+			static bool _concurrent;
+
+			inline static void _schedule();
+
 		public:
 			typedef void(T::*FuncType)(Ts...);
 
 			static const FuncType functionPtr;
 
+			// components the function reads and writes, so it runs alongside systems it doesn't conflict with
+			class Access {
+				const uint32_t _system;
+
+			public:
+				inline Access(uint32_t system) : _system(system) {}
+
+				template <typename ...Cs>
+				inline Access& reads() {
+					IndexPriorityPair& system = *std::find(_systemIndexes.begin(), _systemIndexes.end(), IndexPriorityPair{ _system });
+
+					system.declared = true;
+					system.reads.template add<Cs...>();
+
+					_schedule();
+					return *this;
+				}
+
+				template <typename ...Cs>
+				inline Access& writes() {
+					IndexPriorityPair& system = *std::find(_systemIndexes.begin(), _systemIndexes.end(), IndexPriorityPair{ _system });
+
+					system.declared = true;
+					system.writes.template add<Cs...>();
+
+					_schedule();
+					return *this;
+				}
+
+				// runs on the thread calling SYSFUNC_CALL, before the rest of its wave is spread across threads
+				inline Access& mainThread() {
+					IndexPriorityPair& system = *std::find(_systemIndexes.begin(), _systemIndexes.end(), IndexPriorityPair{ _system });
+
+					system.mainThread = true;
+
+					_schedule();
+					return *this;
+				}
+			};
+
 			template <typename SystemT>
-			inline static void enable(int32_t priority = 0);
+			inline static Access enable(int32_t priority = 0);
 
 			inline static uint32_t systemCount();
 
 			inline static uint32_t systemIndex(uint32_t i);
+
+			inline static bool concurrent();
+
+			inline static uint32_t scheduledIndex(uint32_t i);
+
+			inline static uint32_t scheduledWave(uint32_t i);
+
+			inline static bool scheduledMainThread(uint32_t i);
 		};
 
 		inline virtual ~BaseSystem() {}
@@ -120,37 +286,312 @@ public:
 		inline operator uint64_t() const;
 	};
 
+	// structural changes recorded during iteration, played back in batches as if done in the order recorded
+	class CommandBuffer {
+		friend class SimpleEngine;
+
+		// an add or remove, in the order recorded
+		struct Change {
+			uint32_t type;
+			uint32_t order;
+			uint64_t id;
+			bool remove;
+		};
+
+		class BaseAdds {
+		public:
+			inline virtual ~BaseAdds() {}
+
+			inline virtual void playback(SimpleEngine& engine, const std::vector<uint64_t>& created, const std::vector<Change>& changes) = 0;
+		};
+
+		template <typename T, typename ...Ts>
+		class Adds : public BaseAdds {
+		public:
+			struct Add {
+				uint64_t id;
+				uint32_t order;
+				std::tuple<Ts...> args;
+			};
+
+			std::vector<Add> commands;
+
+			inline void playback(SimpleEngine& engine, const std::vector<uint64_t>& created, const std::vector<Change>& changes) override;
+		};
+
+		uint32_t _creates = 0;
+		std::vector<std::pair<uint32_t, std::function<void(uint64_t)>>> _createCallbacks;
+
+		std::vector<std::unique_ptr<BaseAdds>> _adds[maxComponents]; // one list per component type and argument types
+		std::vector<Change> _changes; // every add and remove, sorted by type, id then order for playback
+		std::vector<uint64_t> _destroys;
+
+		std::vector<uint32_t> _buffered; // indexes created directly during iteration, hidden from it until playback
+
+		inline static uint64_t _resolve(uint64_t id, const std::vector<uint64_t>& created);
+
+		inline static bool _before(const Change& a, const Change& b);
+
+		// whether an add is the first after the last remove of the same component, changes being sorted
+		inline static bool _applies(uint32_t type, uint64_t id, uint32_t order, const std::vector<Change>& changes);
+
+	public:
+		// returns a pending id, only usable with this buffer until played back
+		inline uint64_t createEntity();
+
+		// lambda is called with the new entity's id during playback
+		template <typename T>
+		inline uint64_t createEntity(const T& lambda);
+
+		inline void destroyEntity(uint64_t id);
+
+		template <typename T, typename ...Ts>
+		inline void addComponent(uint64_t id, Ts&&... args);
+
+		template <typename T>
+		inline void removeComponent(uint64_t id);
+
+		inline bool empty() const;
+
+		inline void playback(SimpleEngine& engine);
+	};
+
+	// Returned by SYSFUNC_CALL, calls each enabled system's function with the given args.
+	template <typename T, typename D>
+	class SystemCaller {
+		SimpleEngine& _engine;
+		const D _dispatch;
+
+	public:
+		inline SystemCaller(SimpleEngine& engine, const D& dispatch) : _engine(engine), _dispatch(dispatch) {}
+
+		template <typename ...Ts>
+		inline void operator()(Ts&&... args);
+	};
+
+	// returned by query, only visits entities with the query's components
+	template <typename ...Ts>
+	class Query {
+		SimpleEngine& _engine;
+		QueryCache* _cache;
+
+	public:
+		inline Query(SimpleEngine& engine, QueryCache* cache) : _engine(engine), _cache(cache) {}
+
+		inline uint32_t size() const;
+
+		// same as engine's each and parallelEach
+		template <typename T, typename ...Fs>
+		inline void each(const T& lambda, const Fs&... filters);
+
+		template <typename T, typename ...Fs>
+		inline void parallelEach(const T& lambda, uint32_t batchSize = 1024, const Fs&... filters);
+	};
+
 private:
 	size_t _chunkSize;
+	size_t _highWater = 16 * ChunkPool::blockSize;
 	
 	bool _running = true;
 
 	std::vector<SystemInterface*> _systems;
 
-	std::vector<Identity> _indexIdentities;
+	// identity table, split into parallel arrays by index so scans only pull in what they check
+	std::vector<uint32_t> _versions;
+	std::vector<TypeMask> _masks;
+	std::vector<uint8_t> _flags;
+	std::vector<uint32_t> _references;
 	std::vector<uint32_t> _freeIndexes;
 
 	BasePool* _componentPools[maxComponents] = { nullptr };
 
-	std::vector<uint32_t> _bufferedIndexes;
-	bool _iterating = false;
+	ArchetypeTable _archetypes;
+
+	uint32_t _iterating = 0; // depth of nested iteration
+
+	// engine wide singletons, by resource type index
+	class BaseResource {
+	public:
+		inline virtual ~BaseResource() {}
+	};
+
+	template <typename T>
+	class Resource : public BaseResource {
+	public:
+		T value;
+
+		template <typename ...Ts>
+		inline Resource(Ts&&... args) : value(std::forward<Ts>(args)...) {}
+	};
+
+	std::vector<std::unique_ptr<BaseResource>> _resources;
+
+	// stamped on components when added and changed, the ticks are kept by pools
+	uint32_t _tick = 1;
+
+	std::vector<std::unique_ptr<QueryCache>> _queries;
+	std::vector<QueryCache*> _typeQueries[maxComponents]; // queries including each component type
+
+	JobPool _jobs;
+	std::vector<CommandBuffer> _commandBuffers;
+	bool _threaded = false;
+	bool _parallel = false;
+
+	std::vector<std::unique_ptr<FrameArena>> _frameArenas; // one per worker, reset by endFrame
 
 	inline bool _validId(uint32_t index, uint32_t version) const;
 
+	template <typename T>
+	inline static uint32_t _systemIndex();
+
+	inline uint32_t _pushIdentity();
+
 	inline void _destroy(uint32_t index);
 
+	inline void _removeComponent(uint32_t index, uint32_t type);
+
+	template <typename T>
+	inline void _stampAdded(uint32_t index);
+
+	inline void _updateQueries(uint32_t index, uint32_t type);
+
+	inline void _fillQuery(QueryCache* cache);
+
+	inline void _beginIterating();
+
+	inline void _endIterating();
+
+	// plays back every thread's command buffer, unless nested in an iteration
+	inline void _playback();
+
 	template <typename T>
 	inline void _iterate(uint32_t index, const T& lambda);
 
+	inline uint32_t _match(uint32_t begin, uint32_t end, const TypeMask& mask, uint32_t* indexes) const;
+
+	template <typename T>
+	inline bool _filter(uint32_t index, const Changed<T>& filter) const;
+
+	template <typename T>
+	inline bool _filter(uint32_t index, const Added<T>& filter) const;
+
+	template <typename T>
+	inline void _stamp(uint32_t index);
+
+	template <typename ...Ts, typename T, typename ...Fs>
+	inline void _each(uint32_t index, const TypeMask& mask, const T& lambda, const Fs&... filters);
+
+	template <typename ...Ts, typename T, typename ...Fs>
+	inline void _eachRange(uint32_t begin, uint32_t end, const TypeMask& mask, const T& lambda, const Fs&... filters);
+
+	template <typename ...Ts, typename T, typename ...Fs>
+	inline void _eachRow(Archetype& archetype, uint32_t row, const TypeMask& mask, const T& lambda, const Fs&... filters);
+
+	template <typename T>
+	inline typename ComponentPool<typename std::remove_const<T>::type>::type* _pool() const;
+
+	template <typename T, size_t alignment>
+	inline static const std::vector<uint32_t>* _packedIndexes(const ObjectPool<T, alignment>* pool);
+
+	template <typename T, size_t alignment>
+	inline static const std::vector<uint32_t>* _packedIndexes(const SparsePool<T, alignment>* pool);
+
+	template <typename T>
+	inline static const std::vector<uint32_t>* _packedIndexes(const ArchetypePool<T>* pool);
+
+	template <typename T>
+	inline static const std::vector<uint32_t>* _packedIndexes(const TagPool<T>* pool);
+
+	inline static const std::vector<uint32_t>* _smallerIndexes(const std::vector<uint32_t>* a, const std::vector<uint32_t>* b);
+
+	template <typename T>
+	inline static constexpr bool _archetypeStored();
+
+	template <typename T, size_t alignment>
+	inline static T* _rowComponent(ObjectPool<T, alignment>* pool, Archetype& archetype, uint32_t row, uint32_t index);
+
+	template <typename T, size_t alignment>
+	inline static T* _rowComponent(SparsePool<T, alignment>* pool, Archetype& archetype, uint32_t row, uint32_t index);
+
+	template <typename T>
+	inline static T* _rowComponent(ArchetypePool<T>* pool, Archetype& archetype, uint32_t row, uint32_t index);
+
+	template <typename T>
+	inline static T* _rowComponent(TagPool<T>* pool, Archetype& archetype, uint32_t row, uint32_t index);
+
+	template <typename T, size_t alignment>
+	inline BasePool* _createPool(ObjectPool<T, alignment>*);
+
+	template <typename T, size_t alignment>
+	inline BasePool* _createPool(SparsePool<T, alignment>*);
+
+	template <typename T>
+	inline BasePool* _createPool(ArchetypePool<T>*);
+
+	template <typename T>
+	inline BasePool* _createPool(TagPool<T>*);
+
+	inline static void _writeSection(std::ofstream& stream, const void* data, size_t size);
+
+	inline static const uint8_t* _readSection(const MappedFile& file, size_t* offset, size_t size);
+
+	template <typename ...Cs>
+	inline void _snapshotTypes(Components<Cs...>*, TypeMask* types) const;
+
+	template <typename ...Cs>
+	inline static bool _snapshotType(Components<Cs...>*, uint32_t type, uint32_t size);
+
+	template <typename ...Cs>
+	inline void _saveRegistered(Components<Cs...>*, std::ofstream& stream) const;
+
+	template <typename ...Cs>
+	inline void _loadRegistered(Components<Cs...>*, const std::vector<SnapshotComponents>& records);
+
+	template <typename ...Cs>
+	inline bool _deserialiseRegistered(Components<Cs...>*, const std::vector<SnapshotComponents>& records);
+
+	// trivially copyable, or serialised through ComponentSnapshot
+	template <typename T>
+	inline static constexpr bool _saved();
+
+	template <typename T>
+	inline void _saveComponents(std::ofstream& stream) const;
+
+	template <typename T>
+	inline void _loadComponents(const std::vector<SnapshotComponents>& records);
+
+	template <typename T>
+	inline bool _deserialiseComponents(const std::vector<SnapshotComponents>& records);
+
+	template <typename T, typename D, typename ...Ss, typename ...Ts>
+	inline bool _dispatchRegistered(Systems<Ss...>*, uint32_t index, const D& dispatch, Ts&... args);
+
+	template <typename S, typename D, typename ...Ts>
+	inline bool _dispatchAs(uint32_t index, const D& dispatch, Ts&... args);
+
+	template <typename T, typename D, typename ...Ts>
+	inline void _callSystem(uint32_t index, const D& dispatch, Ts&... args);
+
+	template <typename T, typename D, typename ...Ts>
+	inline void _callSystems(const D& dispatch, Ts&... args);
+
 	// template code to construct component with Engine object reference and its own id
 	template <typename T, typename ...Ts>
-	inline typename std::enable_if<!std::is_constructible<T, SimpleEngine<SystemInterface, maxComponents>&, uint64_t, Ts...>::value>::type _addComponent(uint64_t id, Ts&&... args);
+	inline typename std::enable_if<!std::is_constructible<T, SimpleEngine<SystemInterface, maxComponents, Registries...>&, uint64_t, Ts...>::value>::type _addComponent(uint64_t id, Ts&&... args);
 	
 	template <typename T, typename ...Ts>
-	inline typename std::enable_if<std::is_constructible<T, SimpleEngine<SystemInterface, maxComponents>&, uint64_t, Ts...>::value>::type _addComponent(uint64_t id, Ts&&... args);
+	inline typename std::enable_if<std::is_constructible<T, SimpleEngine<SystemInterface, maxComponents, Registries...>&, uint64_t, Ts...>::value>::type _addComponent(uint64_t id, Ts&&... args);
+
+	template <typename T, typename ...Ts>
+	inline typename std::enable_if<!std::is_constructible<T, SimpleEngine<SystemInterface, maxComponents, Registries...>&, uint64_t, const Ts&...>::value>::type _addComponents(const std::vector<uint32_t>& indexes, const Ts&... args);
+
+	template <typename T, typename ...Ts>
+	inline typename std::enable_if<std::is_constructible<T, SimpleEngine<SystemInterface, maxComponents, Registries...>&, uint64_t, const Ts&...>::value>::type _addComponents(const std::vector<uint32_t>& indexes, const Ts&... args);
 
 public:
-	SimpleEngine(size_t chunkSize) : _chunkSize(chunkSize) {}
+	SimpleEngine(size_t chunkSize) : _chunkSize(chunkSize), _archetypes(maxComponents), _commandBuffers(1) {
+		_frameArenas.emplace_back(new FrameArena());
+	}
 
 	template <typename T, typename ...Ts>
 	inline void registerSystem(Ts&&... args);
@@ -164,25 +605,42 @@ public:
 	template <typename T, typename ...Ts>
 	inline void callSystems(Ts&&... args);
 
+	// used by SYSFUNC_CALL, dispatch calls the function on a registered system's own type
+	template <typename T, typename D>
+	inline SystemCaller<T, D> systemCaller(const D& dispatch);
+
 	inline bool running() const;
 
 	inline void quit();
 
+	// entities created during iteration aren't visited by it, only by passes after it
 	inline uint64_t createEntity();
 
+	// creates count entities at once, writing their ids to ids
+	inline void createEntities(uint32_t count, uint64_t* ids);
+
 	inline bool validEntity(uint64_t id);
 
 	inline void destroyEntity(uint64_t id);
 
+	// null during iteration unless the entity has one already, as the add is done once it's over
 	template <typename T, typename ...Ts>
 	inline T* addComponent(uint64_t id, Ts&&... args);
 
+	// adds a component to count entities at once, each constructed with the same args
+	template <typename T, typename ...Ts>
+	inline void addComponents(const uint64_t* ids, uint32_t count, const Ts&... args);
+
 	template <typename T>
 	inline T* getComponent(uint64_t id);
 
 	template <typename T>
 	inline const T* getComponent(uint64_t id) const;
 
+	// writes through getComponent aren't seen by changed<T> until marked
+	template <typename T>
+	inline void markChanged(uint64_t id);
+
 	template <typename T>
 	inline void removeComponent(uint64_t id);
 
@@ -194,26 +652,127 @@ public:
 	inline void dereferenceEntity(uint64_t id);
 
 	inline uint32_t entityCount() const;
+
+	// long lived query, made once and kept up to date, so iterating it only visits matching entities
+	template <typename ...Ts>
+	inline Query<Ts...> query();
+
+	// fails without writing if any entity has a component which can't be saved
+	inline bool saveSnapshot(const std::string& path) const;
+
+	// into an engine with no entities, the file is checked before anything changes
+	inline bool loadSnapshot(const std::string& path);
+
+	// engine wide singleton, made with args the first time it's used, so it doesn't need an entity
+	template <typename T, typename ...Ts>
+	inline T& resource(Ts&&... args);
+
+	template <typename T>
+	inline bool hasResource() const;
+
+	// returns the current tick and starts the next, for changed<T> and added<T>
+	inline uint32_t tick();
+
+	// whether structural changes are being deferred, such as inside an each lambda
+	inline bool iterating() const;
 	
 	template <typename T>
 	inline void iterateEntities(const T& lambda);
+
+	// filters such as changed<T>(since) and added<T>(since) can be passed after the lambda
+	template <typename ...Ts, typename T, typename ...Fs>
+	inline void each(const T& lambda, const Fs&... filters);
+
+	// threads used by parallelEach, including the calling thread, 0 being hardware concurrency
+	inline void threads(uint32_t count);
+
+	inline uint32_t threadCount() const;
+
+	// like each, but batches are spread across threads, structural changes must go through commands()
+	template <typename ...Ts, typename T, typename ...Fs>
+	inline void parallelEach(const T& lambda, uint32_t batchSize = 1024, const Fs&... filters);
+
+	// calls lambda(begin, end) for batches of [0, count) across threads, same rules as parallelEach
+	template <typename T>
+	inline void parallelFor(uint32_t count, const T& lambda, uint32_t batchSize = 1024);
+
+	// command buffer of calling thread
+	inline CommandBuffer& commands();
+
+	// frame arena of calling thread, for memory only needed until endFrame
+	inline FrameArena& frameArena();
+
+	// ends the main loop's frame, resetting frame arenas
+	inline void endFrame();
+
+	// heap allocations made by every frame arena, stops rising once frames are steady
+	inline uint64_t frameHeapAllocations() const;
+
+	// most bytes of emptied memory each component pool keeps for reuse
+	inline void highWater(size_t bytes);
+
+	// gives back all memory not holding components, such as between levels
+	inline void shrinkToFit();
 };
 
-template <typename SystemInterface, uint32_t maxComponents>
+template <typename SystemInterface, uint32_t maxComponents, typename ...Registries>
 template <typename T, typename ...Ts, void(T::*func)(Ts...)>
-const typename SimpleEngine<SystemInterface, maxComponents>::BaseSystem::FunctionSpecialization<void(T::*)(Ts...), func>::FuncType SimpleEngine<SystemInterface, maxComponents>::BaseSystem::FunctionSpecialization<void(T::*)(Ts...), func>::functionPtr = func;
+const typename SimpleEngine<SystemInterface, maxComponents, Registries...>::BaseSystem::FunctionSpecialization<void(T::*)(Ts...), func>::FuncType SimpleEngine<SystemInterface, maxComponents, Registries...>::BaseSystem::FunctionSpecialization<void(T::*)(Ts...), func>::functionPtr = func;
 
-template <typename SystemInterface, uint32_t maxComponents>
+template <typename SystemInterface, uint32_t maxComponents, typename ...Registries>
 template <typename T, typename ...Ts, void(T::*func)(Ts...)>
-std::vector<typename SimpleEngine<SystemInterface, maxComponents>::IndexPriorityPair> SimpleEngine<SystemInterface, maxComponents>::BaseSystem::FunctionSpecialization<void(T::*)(Ts...), func>::_systemIndexes;
+std::vector<typename SimpleEngine<SystemInterface, maxComponents, Registries...>::IndexPriorityPair> SimpleEngine<SystemInterface, maxComponents, Registries...>::BaseSystem::FunctionSpecialization<void(T::*)(Ts...), func>::_systemIndexes;
+
+template <typename SystemInterface, uint32_t maxComponents, typename ...Registries>
+template <typename T, typename ...Ts, void(T::*func)(Ts...)>
+std::vector<uint32_t> SimpleEngine<SystemInterface, maxComponents, Registries...>::BaseSystem::FunctionSpecialization<void(T::*)(Ts...), func>::_scheduled;
+
+template <typename SystemInterface, uint32_t maxComponents, typename ...Registries>
+template <typename T, typename ...Ts, void(T::*func)(Ts...)>
+bool SimpleEngine<SystemInterface, maxComponents, Registries...>::BaseSystem::FunctionSpecialization<void(T::*)(Ts...), func>::_concurrent = false;
+
+template <typename SystemInterface, uint32_t maxComponents, typename ...Registries>
+template <typename T, typename ...Ts, void(T::*func)(Ts...)>
+void SimpleEngine<SystemInterface, maxComponents, Registries...>::BaseSystem::FunctionSpecialization<void(T::*)(Ts...), func>::_schedule() {
+	// each system's wave is after every higher priority system it conflicts with
+	for (uint32_t i = 0; i < _systemIndexes.size(); i++) {
+		IndexPriorityPair& system = _systemIndexes[i];
+		system.wave = 0;
+
+		for (uint32_t j = 0; j < i; j++) {
+			if (system.conflicts(_systemIndexes[j]))
+				system.wave = std::max(system.wave, _systemIndexes[j].wave + 1);
+		}
+	}
 
-template <typename SystemInterface, uint32_t maxComponents>
+	_scheduled.resize(_systemIndexes.size());
+
+	for (uint32_t i = 0; i < _scheduled.size(); i++)
+		_scheduled[i] = i;
+
+	std::stable_sort(_scheduled.begin(), _scheduled.end(), [](uint32_t a, uint32_t b) {
+		const IndexPriorityPair& first = _systemIndexes[a];
+		const IndexPriorityPair& second = _systemIndexes[b];
+
+		return first.wave < second.wave || (first.wave == second.wave && first.mainThread && !second.mainThread);
+	});
+
+	// only worth going wide if a wave has more than one system
+	_concurrent = false;
+
+	for (uint32_t i = 1; i < _scheduled.size(); i++) {
+		if (_systemIndexes[_scheduled[i]].wave == _systemIndexes[_scheduled[i - 1]].wave)
+			_concurrent = true;
+	}
+}
+
+template <typename SystemInterface, uint32_t maxComponents, typename ...Registries>
 template <typename T, typename ...Ts, void(T::*func)(Ts...)>
 template <typename SystemT>
-void SimpleEngine<SystemInterface, maxComponents>::BaseSystem::FunctionSpecialization<void(T::*)(Ts...), func>::enable(int32_t priority) {
+typename SimpleEngine<SystemInterface, maxComponents, Registries...>::BaseSystem::template FunctionSpecialization<void(T::*)(Ts...), func>::Access SimpleEngine<SystemInterface, maxComponents, Registries...>::BaseSystem::FunctionSpecialization<void(T::*)(Ts...), func>::enable(int32_t priority) {
 	static_assert(std::is_base_of<BaseSystem, SystemInterface>::value);
 
-	IndexPriorityPair indexPriority = { typeIndex<SimpleEngine, SystemT>(), priority };
+	IndexPriorityPair indexPriority = { SimpleEngine::template _systemIndex<SystemT>(), priority };
 
 	auto iter = std::find(_systemIndexes.begin(), _systemIndexes.end(), indexPriority);
 	
@@ -223,401 +782,1674 @@ void SimpleEngine<SystemInterface, maxComponents>::BaseSystem::FunctionSpecializ
 		_systemIndexes.push_back(indexPriority);
 
 	std::sort(_systemIndexes.begin(), _systemIndexes.end());
+
+	_schedule();
+
+	return Access(indexPriority.index);
 }
 
-template <typename SystemInterface, uint32_t maxComponents>
+template <typename SystemInterface, uint32_t maxComponents, typename ...Registries>
 template <typename T, typename ...Ts, void(T::*func)(Ts...)>
-uint32_t SimpleEngine<SystemInterface, maxComponents>::BaseSystem::FunctionSpecialization<void(T::*)(Ts...), func>::systemCount() {
+uint32_t SimpleEngine<SystemInterface, maxComponents, Registries...>::BaseSystem::FunctionSpecialization<void(T::*)(Ts...), func>::systemCount() {
 	assert(_systemIndexes.size() <= UINT32_MAX);
 	return static_cast<uint32_t>(_systemIndexes.size());
 }
 
-template <typename SystemInterface, uint32_t maxComponents>
+template <typename SystemInterface, uint32_t maxComponents, typename ...Registries>
 template <typename T, typename ...Ts, void(T::*func)(Ts...)>
-uint32_t SimpleEngine<SystemInterface, maxComponents>::BaseSystem::FunctionSpecialization<void(T::*)(Ts...), func>::systemIndex(uint32_t i) {
+uint32_t SimpleEngine<SystemInterface, maxComponents, Registries...>::BaseSystem::FunctionSpecialization<void(T::*)(Ts...), func>::systemIndex(uint32_t i) {
 	assert(i < _systemIndexes.size());
 	return _systemIndexes[i].index;
 }
 
-template <typename SystemInterface, uint32_t maxComponents>
-bool SimpleEngine<SystemInterface, maxComponents>::_validId(uint32_t index, uint32_t version) const {
-	if (index >= _indexIdentities.size())
-		return false;
-
-	return version == _indexIdentities[index].version;
+template <typename SystemInterface, uint32_t maxComponents, typename ...Registries>
+template <typename T, typename ...Ts, void(T::*func)(Ts...)>
+bool SimpleEngine<SystemInterface, maxComponents, Registries...>::BaseSystem::FunctionSpecialization<void(T::*)(Ts...), func>::concurrent() {
+	return _concurrent;
 }
 
-template <typename SystemInterface, uint32_t maxComponents>
-void SimpleEngine<SystemInterface, maxComponents>::_destroy(uint32_t index) {
-	//assert(hasFlags(_indexIdentities[index].flags, Identity::Active)); // sanity
-	assert(_indexIdentities[index].flags & Identity::Active); // sanity
+template <typename SystemInterface, uint32_t maxComponents, typename ...Registries>
+template <typename T, typename ...Ts, void(T::*func)(Ts...)>
+uint32_t SimpleEngine<SystemInterface, maxComponents, Registries...>::BaseSystem::FunctionSpecialization<void(T::*)(Ts...), func>::scheduledIndex(uint32_t i) {
+	assert(i < _scheduled.size());
+	return _systemIndexes[_scheduled[i]].index;
+}
 
-	// if references still exist, mark as erased for later, and return
-	if (_indexIdentities[index].references) {
-		_indexIdentities[index].flags |= Identity::Destroyed;
-		return;
-	}
+template <typename SystemInterface, uint32_t maxComponents, typename ...Registries>
+template <typename T, typename ...Ts, void(T::*func)(Ts...)>
+uint32_t SimpleEngine<SystemInterface, maxComponents, Registries...>::BaseSystem::FunctionSpecialization<void(T::*)(Ts...), func>::scheduledWave(uint32_t i) {
+	assert(i < _scheduled.size());
+	return _systemIndexes[_scheduled[i]].wave;
+}
 
-	// remove maxComponents from each pool
-	for (uint32_t i = 0; i < maxComponents; i++) {
-		if (_indexIdentities[index].mask.has(i)) {
-			assert(_componentPools[i]); // sanity
-			_componentPools[i]->erase(index);
-			_indexIdentities[index].mask.sub(i);
-		}
-	}
+template <typename SystemInterface, uint32_t maxComponents, typename ...Registries>
+template <typename T, typename ...Ts, void(T::*func)(Ts...)>
+bool SimpleEngine<SystemInterface, maxComponents, Registries...>::BaseSystem::FunctionSpecialization<void(T::*)(Ts...), func>::scheduledMainThread(uint32_t i) {
+	assert(i < _scheduled.size());
+	return _systemIndexes[_scheduled[i]].mainThread;
+}
 
-	// clear up identity, increment version
-	_indexIdentities[index].version++;
-	_indexIdentities[index].flags = Identity::None;
+template <typename SystemInterface, uint32_t maxComponents, typename ...Registries>
+bool SimpleEngine<SystemInterface, maxComponents, Registries...>::_validId(uint32_t index, uint32_t version) const {
+	if (index >= _versions.size())
+		return false;
 
-	_freeIndexes.push_back(index);
+	return version == _versions[index];
 }
 
-template <typename SystemInterface, uint32_t maxComponents>
+template <typename SystemInterface, uint32_t maxComponents, typename ...Registries>
 template <typename T>
-void SimpleEngine<SystemInterface, maxComponents>::_iterate(uint32_t index, const T& lambda) {
-	Identity& identity = _indexIdentities[index];
+uint32_t SimpleEngine<SystemInterface, maxComponents, Registries...>::_systemIndex() {
+	// registered systems have constant indexes, others are given indexes after them at runtime
+	if constexpr (SystemRegistry::template contains<T>())
+		return SystemRegistry::template index<T>();
+	else
+		return SystemRegistry::size + typeIndex<SimpleEngine, T>();
+}
 
-	//if (!hasFlags(identity.flags, Identity::Active) || hasFlags(identity.flags, Identity::Buffered) || hasFlags(identity.flags, Identity::Destroyed))
-	//	return;
+template <typename SystemInterface, uint32_t maxComponents, typename ...Registries>
+uint32_t SimpleEngine<SystemInterface, maxComponents, Registries...>::_pushIdentity() {
+	assert(_versions.size() < UINT32_MAX);
+	uint32_t index = static_cast<uint32_t>(_versions.size());
 
-	if (!(identity.flags & Identity::Active) ||
-		identity.flags & Identity::Buffered ||
-		identity.flags & Identity::Destroyed)
+	_versions.push_back(1);
+	_masks.emplace_back();
+	_flags.push_back(Identity::None);
+	_references.push_back(0);
+
+	return index;
+}
+
+template <typename SystemInterface, uint32_t maxComponents, typename ...Registries>
+void SimpleEngine<SystemInterface, maxComponents, Registries...>::_destroy(uint32_t index) {
+	//assert(hasFlags(_flags[index], Identity::Active)); // sanity
+	assert(_flags[index] & Identity::Active); // sanity
+
+	// if references still exist, mark as erased for later, and return
+	if (_references[index]) {
+		_flags[index] |= Identity::Destroyed;
+		return;
+	}
+
+	// remove maxComponents from each pool
+	for (uint32_t i = 0; i < maxComponents; i++)
+		_removeComponent(index, i);
+
+	// clear up identity, increment version
+	_versions[index]++;
+	_flags[index] = Identity::None;
+
+	_freeIndexes.push_back(index);
+}
+
+template <typename SystemInterface, uint32_t maxComponents, typename ...Registries>
+void SimpleEngine<SystemInterface, maxComponents, Registries...>::_removeComponent(uint32_t index, uint32_t type) {
+	if (!_masks[index].has(type))
+		return;
+
+	assert(_componentPools[type]); // sanity
+
+	// remove from pool
+	_componentPools[type]->erase(index);
+
+	// update identity
+	_masks[index].sub(type);
+
+	_updateQueries(index, type);
+}
+
+template <typename SystemInterface, uint32_t maxComponents, typename ...Registries>
+template <typename T>
+void SimpleEngine<SystemInterface, maxComponents, Registries...>::_stampAdded(uint32_t index) {
+	ChangeTicks* ticks = _pool<T>()->ticks(index);
+
+	ticks->added = _tick;
+	ticks->changed = _tick;
+}
+
+template <typename SystemInterface, uint32_t maxComponents, typename ...Registries>
+void SimpleEngine<SystemInterface, maxComponents, Registries...>::_updateQueries(uint32_t index, uint32_t type) {
+	for (QueryCache* cache : _typeQueries[type])
+		cache->update(index, _masks[index].has(cache->mask));
+}
+
+template <typename SystemInterface, uint32_t maxComponents, typename ...Registries>
+void SimpleEngine<SystemInterface, maxComponents, Registries...>::_fillQuery(QueryCache* cache) {
+	cache->indexes.clear();
+	cache->positions.clear();
+
+	for (uint32_t i = 0; i < _versions.size(); i++) {
+		if (_flags[i] & Identity::Active)
+			cache->update(i, _masks[i].has(cache->mask));
+	}
+}
+
+template <typename SystemInterface, uint32_t maxComponents, typename ...Registries>
+void SimpleEngine<SystemInterface, maxComponents, Registries...>::QueryCache::update(uint32_t index, bool matches) {
+	bool cached = index < positions.size() && positions[index] != UINT32_MAX;
+
+	if (matches == cached)
+		return;
+
+	if (matches) {
+		if (index >= positions.size())
+			positions.resize(index + 1, UINT32_MAX);
+
+		assert(indexes.size() < UINT32_MAX);
+		positions[index] = static_cast<uint32_t>(indexes.size());
+		indexes.push_back(index);
+		return;
+	}
+
+	// swap last into its place
+	uint32_t position = positions[index];
+
+	indexes[position] = indexes.back();
+	positions[indexes[position]] = position;
+
+	indexes.pop_back();
+	positions[index] = UINT32_MAX;
+}
+
+template <typename SystemInterface, uint32_t maxComponents, typename ...Registries>
+void SimpleEngine<SystemInterface, maxComponents, Registries...>::_beginIterating() {
+	// systems running in parallel can't change structure, so there is nothing to defer
+	if (!_parallel)
+		_iterating++;
+}
+
+template <typename SystemInterface, uint32_t maxComponents, typename ...Registries>
+void SimpleEngine<SystemInterface, maxComponents, Registries...>::_endIterating() {
+	if (_parallel)
+		return;
+
+	assert(_iterating);
+
+	// apply changes deferred during iteration once the outermost iteration is done
+	if (--_iterating == 0)
+		_playback();
+}
+
+template <typename SystemInterface, uint32_t maxComponents, typename ...Registries>
+void SimpleEngine<SystemInterface, maxComponents, Registries...>::_playback() {
+	if (_iterating)
+		return;
+
+	for (CommandBuffer& commands : _commandBuffers)
+		commands.playback(*this);
+}
+
+template <typename SystemInterface, uint32_t maxComponents, typename ...Registries>
+template <typename T>
+void SimpleEngine<SystemInterface, maxComponents, Registries...>::_iterate(uint32_t index, const T& lambda) {
+	uint8_t flags = _flags[index];
+
+	//if (!hasFlags(flags, Identity::Active) || hasFlags(flags, Identity::Buffered) || hasFlags(flags, Identity::Destroyed))
+	//	return;
+
+	if (!(flags & Identity::Active) ||
+		flags & Identity::Buffered ||
+		flags & Identity::Destroyed)
+		return;
+
+	Entity entity(*this);
+	entity.set(combine32(index, _versions[index]));
+
+	lambda(entity);
+}
+
+template <typename SystemInterface, uint32_t maxComponents, typename ...Registries>
+template <typename T>
+bool SimpleEngine<SystemInterface, maxComponents, Registries...>::_filter(uint32_t index, const Changed<T>& filter) const {
+	// filtered types needn't be iterated ones, so may be missing
+	return _masks[index].template has<T>() && _pool<T>()->ticks(index)->changed > filter.since;
+}
+
+template <typename SystemInterface, uint32_t maxComponents, typename ...Registries>
+template <typename T>
+bool SimpleEngine<SystemInterface, maxComponents, Registries...>::_filter(uint32_t index, const Added<T>& filter) const {
+	return _masks[index].template has<T>() && _pool<T>()->ticks(index)->added > filter.since;
+}
+
+template <typename SystemInterface, uint32_t maxComponents, typename ...Registries>
+template <typename T>
+void SimpleEngine<SystemInterface, maxComponents, Registries...>::_stamp(uint32_t index) {
+	// only mutable iteration counts as a change, lookups through getComponent don't
+	if constexpr (!std::is_const<T>::value)
+		_pool<T>()->ticks(index)->changed = _tick;
+}
+
+template <typename SystemInterface, uint32_t maxComponents, typename ...Registries>
+template <typename ...Ts, typename T, typename ...Fs>
+void SimpleEngine<SystemInterface, maxComponents, Registries...>::_each(uint32_t index, const TypeMask& mask, const T& lambda, const Fs&... filters) {
+	// only active entities, not buffered or destroyed
+	if (_flags[index] != Identity::Active || !_masks[index].has(mask))
+		return;
+
+	if (!(_filter(index, filters) && ...))
+		return;
+
+	(_stamp<Ts>(index), ...);
+
+	lambda(combine32(index, _versions[index]), *_pool<Ts>()->get(index)...);
+}
+
+template <typename SystemInterface, uint32_t maxComponents, typename ...Registries>
+uint32_t SimpleEngine<SystemInterface, maxComponents, Registries...>::_match(uint32_t begin, uint32_t end, const TypeMask& mask, uint32_t* indexes) const {
+	uint32_t count = 0;
+
+	// masks are checked several entities at a time, then only matches have their flags checked
+	for (uint32_t i = begin; i < end; i += 64) {
+		uint64_t matches = TypeMask::hasEach(&_masks[i], std::min(end - i, 64u), mask);
+
+		while (matches) {
+			uint32_t index = i + lowestBit(matches);
+			matches &= matches - 1;
+
+			indexes[count] = index;
+			count += _flags[index] == Identity::Active;
+		}
+	}
+
+	return count;
+}
+
+template <typename SystemInterface, uint32_t maxComponents, typename ...Registries>
+template <typename ...Ts, typename T, typename ...Fs>
+void SimpleEngine<SystemInterface, maxComponents, Registries...>::_eachRange(uint32_t begin, uint32_t end, const TypeMask& mask, const T& lambda, const Fs&... filters) {
+	const uint32_t blockSize = 256;
+	uint32_t indexes[blockSize];
+
+	// matched a block at a time, then checked again in case the lambda changed a later one
+	for (uint32_t block = begin; block < end; block += blockSize) {
+		uint32_t count = _match(block, std::min(block + blockSize, end), mask, indexes);
+
+		for (uint32_t i = 0; i < count; i++)
+			_each<Ts...>(indexes[i], mask, lambda, filters...);
+	}
+}
+
+template <typename SystemInterface, uint32_t maxComponents, typename ...Registries>
+template <typename ...Ts, typename T, typename ...Fs>
+void SimpleEngine<SystemInterface, maxComponents, Registries...>::_eachRow(Archetype& archetype, uint32_t row, const TypeMask& mask, const T& lambda, const Fs&... filters) {
+	uint32_t index = archetype.indexes()[row];
+
+	// only active entities, not buffered or destroyed
+	if (_flags[index] != Identity::Active)
+		return;
+
+	// archetype has its own components, so only check the mask for others
+	if (!(_archetypeStored<Ts>() && ...) && !_masks[index].has(mask))
+		return;
+
+	if (!(_filter(index, filters) && ...))
+		return;
+
+	(_stamp<Ts>(index), ...);
+
+	lambda(combine32(index, _versions[index]), *_rowComponent(_pool<Ts>(), archetype, row, index)...);
+}
+
+template <typename SystemInterface, uint32_t maxComponents, typename ...Registries>
+template <typename T>
+typename ComponentPool<typename std::remove_const<T>::type>::type* SimpleEngine<SystemInterface, maxComponents, Registries...>::_pool() const {
+	using Component = typename std::remove_const<T>::type;
+
+	return static_cast<typename ComponentPool<Component>::type*>(_componentPools[TypeMask::template index<Component>()]);
+}
+
+template <typename SystemInterface, uint32_t maxComponents, typename ...Registries>
+template <typename T, size_t alignment>
+const std::vector<uint32_t>* SimpleEngine<SystemInterface, maxComponents, Registries...>::_packedIndexes(const ObjectPool<T, alignment>*) {
+	return nullptr;
+}
+
+template <typename SystemInterface, uint32_t maxComponents, typename ...Registries>
+template <typename T, size_t alignment>
+const std::vector<uint32_t>* SimpleEngine<SystemInterface, maxComponents, Registries...>::_packedIndexes(const SparsePool<T, alignment>* pool) {
+	return &pool->indexes();
+}
+
+template <typename SystemInterface, uint32_t maxComponents, typename ...Registries>
+template <typename T>
+const std::vector<uint32_t>* SimpleEngine<SystemInterface, maxComponents, Registries...>::_packedIndexes(const ArchetypePool<T>*) {
+	return nullptr;
+}
+
+template <typename SystemInterface, uint32_t maxComponents, typename ...Registries>
+template <typename T>
+const std::vector<uint32_t>* SimpleEngine<SystemInterface, maxComponents, Registries...>::_packedIndexes(const TagPool<T>*) {
+	return nullptr;
+}
+
+template <typename SystemInterface, uint32_t maxComponents, typename ...Registries>
+const std::vector<uint32_t>* SimpleEngine<SystemInterface, maxComponents, Registries...>::_smallerIndexes(const std::vector<uint32_t>* a, const std::vector<uint32_t>* b) {
+	if (!a || (b && b->size() < a->size()))
+		return b;
+
+	return a;
+}
+
+template <typename SystemInterface, uint32_t maxComponents, typename ...Registries>
+template <typename T>
+constexpr bool SimpleEngine<SystemInterface, maxComponents, Registries...>::_archetypeStored() {
+	using Component = typename std::remove_const<T>::type;
+
+	return std::is_same<typename ComponentPool<Component>::type, ArchetypePool<Component>>::value;
+}
+
+template <typename SystemInterface, uint32_t maxComponents, typename ...Registries>
+template <typename T, size_t alignment>
+T* SimpleEngine<SystemInterface, maxComponents, Registries...>::_rowComponent(ObjectPool<T, alignment>* pool, Archetype&, uint32_t, uint32_t index) {
+	return pool->get(index);
+}
+
+template <typename SystemInterface, uint32_t maxComponents, typename ...Registries>
+template <typename T, size_t alignment>
+T* SimpleEngine<SystemInterface, maxComponents, Registries...>::_rowComponent(SparsePool<T, alignment>* pool, Archetype&, uint32_t, uint32_t index) {
+	return pool->get(index);
+}
+
+template <typename SystemInterface, uint32_t maxComponents, typename ...Registries>
+template <typename T>
+T* SimpleEngine<SystemInterface, maxComponents, Registries...>::_rowComponent(ArchetypePool<T>* pool, Archetype& archetype, uint32_t row, uint32_t) {
+	return archetype.get<T>(row, archetype.column(pool->type()));
+}
+
+template <typename SystemInterface, uint32_t maxComponents, typename ...Registries>
+template <typename T>
+T* SimpleEngine<SystemInterface, maxComponents, Registries...>::_rowComponent(TagPool<T>* pool, Archetype&, uint32_t, uint32_t index) {
+	return pool->get(index);
+}
+
+template <typename SystemInterface, uint32_t maxComponents, typename ...Registries>
+template <typename T, size_t alignment>
+BasePool* SimpleEngine<SystemInterface, maxComponents, Registries...>::_createPool(ObjectPool<T, alignment>*) {
+	ObjectPool<T, alignment>* pool = new ObjectPool<T, alignment>(_chunkSize);
+	pool->highWater(_highWater);
+
+	return pool;
+}
+
+template <typename SystemInterface, uint32_t maxComponents, typename ...Registries>
+template <typename T, size_t alignment>
+BasePool* SimpleEngine<SystemInterface, maxComponents, Registries...>::_createPool(SparsePool<T, alignment>*) {
+	SparsePool<T, alignment>* pool = new SparsePool<T, alignment>(_chunkSize);
+	pool->highWater(_highWater);
+
+	return pool;
+}
+
+template <typename SystemInterface, uint32_t maxComponents, typename ...Registries>
+template <typename T>
+BasePool* SimpleEngine<SystemInterface, maxComponents, Registries...>::_createPool(ArchetypePool<T>*) {
+	return new ArchetypePool<T>(_archetypes, TypeMask::template index<T>());
+}
+
+template <typename SystemInterface, uint32_t maxComponents, typename ...Registries>
+template <typename T>
+BasePool* SimpleEngine<SystemInterface, maxComponents, Registries...>::_createPool(TagPool<T>*) {
+	return new TagPool<T>();
+}
+
+template<typename SystemInterface, uint32_t maxComponents, typename ...Registries>
+template<typename T, typename ...Ts>
+typename std::enable_if<!std::is_constructible<T, SimpleEngine<SystemInterface, maxComponents, Registries...>&, uint64_t, Ts...>::value>::type SimpleEngine<SystemInterface, maxComponents, Registries...>::_addComponent(uint64_t id, Ts && ...args){
+	// construct component with provided args
+	_pool<T>()->insert(front64(id), std::forward<Ts>(args)...);
+}
+
+template<typename SystemInterface, uint32_t maxComponents, typename ...Registries>
+template<typename T, typename ...Ts>
+typename std::enable_if<std::is_constructible<T, SimpleEngine<SystemInterface, maxComponents, Registries...>&, uint64_t, Ts...>::value>::type SimpleEngine<SystemInterface, maxComponents, Registries...>::_addComponent(uint64_t id, Ts && ...args) {
+	// construct component with Engine object reference and its own ID, along with provided args
+	_pool<T>()->insert(front64(id), *this, id, std::forward<Ts>(args)...);
+}
+
+template<typename SystemInterface, uint32_t maxComponents, typename ...Registries>
+template<typename T, typename ...Ts>
+typename std::enable_if<!std::is_constructible<T, SimpleEngine<SystemInterface, maxComponents, Registries...>&, uint64_t, const Ts&...>::value>::type SimpleEngine<SystemInterface, maxComponents, Registries...>::_addComponents(const std::vector<uint32_t>& indexes, const Ts&... args) {
+	// construct all components with provided args
+	_pool<T>()->insertBatch(indexes.data(), static_cast<uint32_t>(indexes.size()), args...);
+}
+
+template<typename SystemInterface, uint32_t maxComponents, typename ...Registries>
+template<typename T, typename ...Ts>
+typename std::enable_if<std::is_constructible<T, SimpleEngine<SystemInterface, maxComponents, Registries...>&, uint64_t, const Ts&...>::value>::type SimpleEngine<SystemInterface, maxComponents, Registries...>::_addComponents(const std::vector<uint32_t>& indexes, const Ts&... args) {
+	// each needs its own ID, so construct one at a time
+	for (uint32_t index : indexes)
+		_pool<T>()->insert(index, *this, combine32(index, _versions[index]), args...);
+}
+
+template <typename SystemInterface, uint32_t maxComponents, typename ...Registries>
+template<typename T, typename ...Ts>
+void SimpleEngine<SystemInterface, maxComponents, Registries...>::registerSystem(Ts&&... args){
+	static_assert(std::is_base_of<BaseSystem, SystemInterface>::value);
+	static_assert(std::is_base_of<SystemInterface, T>::value);
+
+	uint32_t index = _systemIndex<T>();
+
+	if (_systems.size() <= index)
+		_systems.resize(index + 1);
+
+	assert(_systems[index] == nullptr);
+
+	_systems[index] = new T(std::forward<Ts>(args)...);
+}
+
+template<typename SystemInterface, uint32_t maxComponents, typename ...Registries>
+template<typename T>
+bool SimpleEngine<SystemInterface, maxComponents, Registries...>::hasSystem(){
+	uint32_t index = _systemIndex<T>();
+
+	if (_systems.size() <= index)
+		return false;
+
+	return _systems[index] != nullptr;
+}
+
+template <typename SystemInterface, uint32_t maxComponents, typename ...Registries>
+template<typename T>
+T& SimpleEngine<SystemInterface, maxComponents, Registries...>::system(){
+	uint32_t index = _systemIndex<T>();
+
+	if (_systems.size() <= index)
+		_systems.resize(index + 1);
+
+	assert(_systems[index] != nullptr);
+
+	return *static_cast<T*>(_systems[index]);
+}
+
+template <typename SystemInterface, uint32_t maxComponents, typename ...Registries>
+void SimpleEngine<SystemInterface, maxComponents, Registries...>::_writeSection(std::ofstream& stream, const void* data, size_t size) {
+	const char padding[8] = {};
+
+	stream.write(static_cast<const char*>(data), size);
+	stream.write(padding, (8 - size % 8) % 8);
+}
+
+template <typename SystemInterface, uint32_t maxComponents, typename ...Registries>
+const uint8_t* SimpleEngine<SystemInterface, maxComponents, Registries...>::_readSection(const MappedFile& file, size_t* offset, size_t size) {
+	if (*offset > file.size() || size > file.size() - *offset)
+		return nullptr;
+
+	const uint8_t* section = file.data() + *offset;
+	*offset += (size + 7) / 8 * 8;
+
+	return section;
+}
+
+template <typename SystemInterface, uint32_t maxComponents, typename ...Registries>
+template <typename ...Cs>
+void SimpleEngine<SystemInterface, maxComponents, Registries...>::_snapshotTypes(Components<Cs...>*, TypeMask* types) const {
+	((_saved<Cs>() && _pool<Cs>() ? types->add(TypeMask::template index<Cs>()) : void()), ...);
+}
+
+template <typename SystemInterface, uint32_t maxComponents, typename ...Registries>
+template <typename ...Cs>
+bool SimpleEngine<SystemInterface, maxComponents, Registries...>::_snapshotType(Components<Cs...>*, uint32_t type, uint32_t size) {
+	return ((_saved<Cs>() && type == TypeMask::template index<Cs>() && size == (std::is_trivially_copyable<Cs>::value ? sizeof(Cs) : 0)) || ...);
+}
+
+template <typename SystemInterface, uint32_t maxComponents, typename ...Registries>
+template <typename ...Cs>
+void SimpleEngine<SystemInterface, maxComponents, Registries...>::_saveRegistered(Components<Cs...>*, std::ofstream& stream) const {
+	(_saveComponents<Cs>(stream), ...);
+}
+
+template <typename SystemInterface, uint32_t maxComponents, typename ...Registries>
+template <typename ...Cs>
+void SimpleEngine<SystemInterface, maxComponents, Registries...>::_loadRegistered(Components<Cs...>*, const std::vector<SnapshotComponents>& records) {
+	(_loadComponents<Cs>(records), ...);
+}
+
+template <typename SystemInterface, uint32_t maxComponents, typename ...Registries>
+template <typename ...Cs>
+bool SimpleEngine<SystemInterface, maxComponents, Registries...>::_deserialiseRegistered(Components<Cs...>*, const std::vector<SnapshotComponents>& records) {
+	return (_deserialiseComponents<Cs>(records) && ...);
+}
+
+template <typename SystemInterface, uint32_t maxComponents, typename ...Registries>
+template <typename T>
+constexpr bool SimpleEngine<SystemInterface, maxComponents, Registries...>::_saved() {
+	return std::is_trivially_copyable<T>::value || ComponentSnapshot<T>::saved;
+}
+
+template <typename SystemInterface, uint32_t maxComponents, typename ...Registries>
+template <typename T>
+void SimpleEngine<SystemInterface, maxComponents, Registries...>::_saveComponents(std::ofstream& stream) const {
+	if constexpr (_saved<T>()) {
+		if (!_pool<T>())
+			return;
+
+		uint32_t type = TypeMask::template index<T>();
+
+		std::vector<uint32_t> indexes;
+
+		for (uint32_t i = 0; i < _versions.size(); i++) {
+			if (_masks[i].has(type))
+				indexes.push_back(i);
+		}
+
+		const uint32_t size = std::is_trivially_copyable<T>::value ? sizeof(T) : 0;
+		SnapshotRecord record = { type, size, static_cast<uint32_t>(indexes.size()), 0 };
+
+		_writeSection(stream, &record, sizeof(SnapshotRecord));
+		_writeSection(stream, indexes.data(), indexes.size() * sizeof(uint32_t));
+
+		std::vector<uint8_t> components;
+
+		if constexpr (std::is_trivially_copyable<T>::value) {
+			// gathered in index order, so loading into index addressed pools copies whole runs
+			components.resize(indexes.size() * sizeof(T));
+
+			for (uint32_t i = 0; i < indexes.size(); i++)
+				memcpy(components.data() + i * sizeof(T), _pool<T>()->get(indexes[i]), sizeof(T));
+		}
+		else {
+			std::vector<uint32_t> offsets;
+			offsets.reserve(indexes.size() + 1);
+
+			for (uint32_t index : indexes) {
+				offsets.push_back(static_cast<uint32_t>(components.size()));
+				ComponentSnapshot<T>::save(*_pool<T>()->get(index), &components);
+			}
+
+			assert(components.size() <= UINT32_MAX);
+			offsets.push_back(static_cast<uint32_t>(components.size()));
+
+			_writeSection(stream, offsets.data(), offsets.size() * sizeof(uint32_t));
+		}
+
+		_writeSection(stream, components.data(), components.size());
+	}
+}
+
+template <typename SystemInterface, uint32_t maxComponents, typename ...Registries>
+template <typename T>
+void SimpleEngine<SystemInterface, maxComponents, Registries...>::_loadComponents(const std::vector<SnapshotComponents>& records) {
+	if constexpr (std::is_trivially_copyable<T>::value) {
+		uint32_t type = TypeMask::template index<T>();
+
+		for (const SnapshotComponents& components : records) {
+			if (components.record->type != type)
+				continue;
+
+			if (_componentPools[type] == nullptr)
+				_componentPools[type] = _createPool<T>(static_cast<typename ComponentPool<T>::type*>(nullptr));
+
+			_pool<T>()->load(components.indexes, components.record->count, components.components);
+
+			for (uint32_t i = 0; i < components.record->count; i++)
+				_stampAdded<T>(components.indexes[i]);
+		}
+	}
+}
+
+template <typename SystemInterface, uint32_t maxComponents, typename ...Registries>
+template <typename T>
+bool SimpleEngine<SystemInterface, maxComponents, Registries...>::_deserialiseComponents(const std::vector<SnapshotComponents>& records) {
+	if constexpr (!std::is_trivially_copyable<T>::value && ComponentSnapshot<T>::saved) {
+		uint32_t type = TypeMask::template index<T>();
+
+		for (const SnapshotComponents& components : records) {
+			if (components.record->type != type)
+				continue;
+
+			for (uint32_t i = 0; i < components.record->count; i++) {
+				uint32_t index = components.indexes[i];
+
+				// entities destroyed while referenced are destroyed again once loaded, so don't need them
+				if (_flags[index] != Identity::Active)
+					continue;
+
+				const uint8_t* bytes = components.components + components.offsets[i];
+
+				if (!ComponentSnapshot<T>::load(*this, combine32(index, _versions[index]), bytes, components.offsets[i + 1] - components.offsets[i]))
+					return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+template <typename SystemInterface, uint32_t maxComponents, typename ...Registries>
+template <typename T, typename D, typename ...Ss, typename ...Ts>
+bool SimpleEngine<SystemInterface, maxComponents, Registries...>::_dispatchRegistered(Systems<Ss...>*, uint32_t index, const D& dispatch, Ts&... args) {
+	// registered system types are known, so cast to the one at index and call through its own type
+	if constexpr (sizeof...(Ss) == 0)
+		return false;
+	else
+		return ((index == SystemRegistry::template index<Ss>() && _dispatchAs<Ss>(index, dispatch, args...)) || ...);
+}
+
+template <typename SystemInterface, uint32_t maxComponents, typename ...Registries>
+template <typename S, typename D, typename ...Ts>
+bool SimpleEngine<SystemInterface, maxComponents, Registries...>::_dispatchAs(uint32_t index, const D& dispatch, Ts&... args) {
+	// systems only forward declared at the call site are called through the interface
+	if constexpr (IsComplete<S, D>::value) {
+		dispatch(static_cast<S*>(_systems[index]), args...);
+		return true;
+	}
+	else {
+		return false;
+	}
+}
+
+template <typename SystemInterface, uint32_t maxComponents, typename ...Registries>
+template <typename T, typename D, typename ...Ts>
+void SimpleEngine<SystemInterface, maxComponents, Registries...>::_callSystem(uint32_t index, const D& dispatch, Ts&... args) {
+	if (!_dispatchRegistered<T>(static_cast<SystemRegistry*>(nullptr), index, dispatch, args...))
+		(_systems[index]->*T::functionPtr)(args...);
+}
+
+template <typename SystemInterface, uint32_t maxComponents, typename ...Registries>
+template <typename T, typename D, typename ...Ts>
+void SimpleEngine<SystemInterface, maxComponents, Registries...>::_callSystems(const D& dispatch, Ts&... args) {
+	if (!T::concurrent() || _parallel) {
+		for (uint32_t i = 0; i < T::systemCount(); i++) {
+			_callSystem<T>(T::systemIndex(i), dispatch, args...);
+		}
+
+		return;
+	}
+
+	if (!_threaded)
+		threads(0);
+
+	// run each wave of non conflicting systems together, lone systems stay on the calling thread
+	for (uint32_t begin = 0, end = 0; begin < T::systemCount(); begin = end) {
+		while (end < T::systemCount() && T::scheduledWave(end) == T::scheduledWave(begin))
+			end++;
+
+		// systems kept on this thread are first in their wave
+		while (begin < end && T::scheduledMainThread(begin))
+			_callSystem<T>(T::scheduledIndex(begin++), dispatch, args...);
+
+		if (begin == end)
+			continue;
+
+		if (end - begin == 1) {
+			_callSystem<T>(T::scheduledIndex(begin), dispatch, args...);
+			continue;
+		}
+
+		_parallel = true;
+
+		_jobs.run(end - begin, [&](uint32_t job, uint32_t) {
+			_callSystem<T>(T::scheduledIndex(begin + job), dispatch, args...);
+		});
+
+		_parallel = false;
+	}
+
+	// apply structural changes recorded by systems that ran in parallel
+	_playback();
+}
+
+template <typename SystemInterface, uint32_t maxComponents, typename ...Registries>
+template <typename T, typename ...Ts>
+void SimpleEngine<SystemInterface, maxComponents, Registries...>::callSystems(Ts&&... args) {
+	// calls through the interface
+	_callSystems<T>([](SystemInterface* system, auto&... args) {
+		(system->*T::functionPtr)(args...);
+	}, args...);
+}
+
+template <typename SystemInterface, uint32_t maxComponents, typename ...Registries>
+template <typename T, typename D>
+typename SimpleEngine<SystemInterface, maxComponents, Registries...>::template SystemCaller<T, D> SimpleEngine<SystemInterface, maxComponents, Registries...>::systemCaller(const D& dispatch) {
+	return SystemCaller<T, D>(*this, dispatch);
+}
+
+template <typename SystemInterface, uint32_t maxComponents, typename ...Registries>
+template <typename T, typename D>
+template <typename ...Ts>
+void SimpleEngine<SystemInterface, maxComponents, Registries...>::SystemCaller<T, D>::operator()(Ts&&... args) {
+	_engine._callSystems<T>(_dispatch, args...);
+}
+
+template <typename SystemInterface, uint32_t maxComponents, typename ...Registries>
+bool SimpleEngine<SystemInterface, maxComponents, Registries...>::running() const {
+	return _running;
+}
+
+template <typename SystemInterface, uint32_t maxComponents, typename ...Registries>
+void SimpleEngine<SystemInterface, maxComponents, Registries...>::quit(){
+	_running = false;
+}
+
+template <typename SystemInterface, uint32_t maxComponents, typename ...Registries>
+uint64_t SimpleEngine<SystemInterface, maxComponents, Registries...>::createEntity() {
+	assert(!_parallel && "use commands() during parallelEach");
+
+	// find free index
+	uint32_t index;
+
+	if (_freeIndexes.empty()) {
+		index = _pushIdentity();
+	}
+	else {
+		index = *_freeIndexes.rbegin();
+		_freeIndexes.pop_back();
+	}
+
+	// set identity flags to active
+	assert(!_references[index]); // sanity
+	//assert(!hasFlags(_flags[index], Identity::Active)); // sanity
+	assert(!(_flags[index] & Identity::Active)); // sanity
+
+	_flags[index] = Identity::Active;
+
+	// if made during iteration, hide from it until it's done
+	if (_iterating) {
+		_flags[index] |= Identity::Buffered;
+		commands()._buffered.push_back(index);
+	}
+
+	// return index and version combined
+	return combine32(index, _versions[index]);
+}
+
+template <typename SystemInterface, uint32_t maxComponents, typename ...Registries>
+void SimpleEngine<SystemInterface, maxComponents, Registries...>::createEntities(uint32_t count, uint64_t* ids) {
+	assert(!_parallel && "use commands() during parallelEach");
+
+	// reuse free indexes first, then grow identities once for the rest
+	uint32_t reused = static_cast<uint32_t>(std::min<size_t>(count, _freeIndexes.size()));
+
+	assert(_versions.size() + (count - reused) <= UINT32_MAX);
+	size_t size = _versions.size() + (count - reused);
+
+	_versions.reserve(size);
+	_masks.reserve(size);
+	_flags.reserve(size);
+	_references.reserve(size);
+
+	for (uint32_t i = 0; i < count; i++) {
+		uint32_t index;
+
+		if (i < reused) {
+			index = *_freeIndexes.rbegin();
+			_freeIndexes.pop_back();
+		}
+		else {
+			index = _pushIdentity();
+		}
+
+		assert(!_references[index] && !(_flags[index] & Identity::Active)); // sanity
+
+		_flags[index] = Identity::Active;
+
+		// if made during iteration, hide from it until it's done
+		if (_iterating) {
+			_flags[index] |= Identity::Buffered;
+			commands()._buffered.push_back(index);
+		}
+
+		ids[i] = combine32(index, _versions[index]);
+	}
+}
+
+template <typename SystemInterface, uint32_t maxComponents, typename ...Registries>
+bool SimpleEngine<SystemInterface, maxComponents, Registries...>::validEntity(uint64_t id) {
+	if (id == 0)
+		return false;
+
+	uint32_t index = front64(id);
+	uint32_t version = back64(id);
+
+	return _validId(index, version);
+}
+
+template <typename SystemInterface, uint32_t maxComponents, typename ...Registries>
+void SimpleEngine<SystemInterface, maxComponents, Registries...>::destroyEntity(uint64_t id) {
+	assert(!_parallel && "use commands() during parallelEach");
+
+	uint32_t index = front64(id);
+	uint32_t version = back64(id);
+
+	assert(_validId(index, version) && "calling erase with invalid id");
+
+	if (!_validId(index, version))
+		return;
+
+	// if destroyed during iteration, skip it for the rest of the pass and destroy once done
+	if (_iterating) {
+		_flags[index] |= Identity::Destroyed;
+		commands().destroyEntity(id);
+		return;
+	}
+
+	_destroy(index);
+}
+
+template <typename SystemInterface, uint32_t maxComponents, typename ...Registries>
+template <typename T, typename ...Ts>
+T* SimpleEngine<SystemInterface, maxComponents, Registries...>::addComponent(uint64_t id, Ts&&... args) {
+	//static_assert(std::is_constructible<T, Ts...>::value);
+
+	assert(!_parallel && "use commands() during parallelEach");
+
+	uint32_t index = front64(id);
+	uint32_t version = back64(id);
+
+	assert(_validId(index, version) && "calling add with invalid id");
+
+	if (!_validId(index, version))
+		return nullptr;
+
+	//assert(hasFlags(_flags[index], Identity::Active)); // sanity
+	assert(_flags[index] & Identity::Active); // sanity
+
+	uint32_t type = TypeMask::index<T>();
+	bool has = _masks[index].has<T>();
+
+	// if added during iteration, add once done, even if it has one as a remove may be pending
+	if (_iterating)
+		commands().template addComponent<T>(id, std::forward<Ts>(args)...);
+
+	// adding again is a write
+	if (has) {
+		_pool<T>()->ticks(index)->changed = _tick;
+		return _pool<T>()->get(index);
+	}
+
+	if (_iterating)
+		return nullptr;
+
+	// update identity
+	_masks[index].add<T>();
+	_updateQueries(index, type);
+
+	// create pool if it doesn't exist
+	if (_componentPools[type] == nullptr)
+		_componentPools[type] = _createPool<T>(static_cast<typename ComponentPool<T>::type*>(nullptr));
+
+	//_componentPools[TypeMask::index<T>()]->insert<T>(index, std::forward<Ts>(args)...);
+
+	_addComponent<T>(id, std::forward<Ts>(args)...);
+	_stampAdded<T>(index);
+
+	return _pool<T>()->get(index);
+}
+
+template <typename SystemInterface, uint32_t maxComponents, typename ...Registries>
+template <typename T, typename ...Ts>
+void SimpleEngine<SystemInterface, maxComponents, Registries...>::addComponents(const uint64_t* ids, uint32_t count, const Ts&... args) {
+	assert(!_parallel && "use commands() during parallelEach");
+
+	// if added during iteration, add once done
+	if (_iterating) {
+		for (uint32_t i = 0; i < count; i++)
+			commands().template addComponent<T>(ids[i], args...);
+
+		return;
+	}
+
+	uint32_t type = TypeMask::template index<T>();
+
+	// create pool if it doesn't exist
+	if (_componentPools[type] == nullptr)
+		_componentPools[type] = _createPool<T>(static_cast<typename ComponentPool<T>::type*>(nullptr));
+
+	// update identities in one pass, skipping any which already have one
+	std::vector<uint32_t> indexes;
+	indexes.reserve(count);
+
+	for (uint32_t i = 0; i < count; i++) {
+		uint32_t index = front64(ids[i]);
+		uint32_t version = back64(ids[i]);
+
+		assert(_validId(index, version) && "calling add with invalid id");
+
+		if (!_validId(index, version) || _masks[index].has(type))
+			continue;
+
+		assert(_flags[index] & Identity::Active); // sanity
+
+		_masks[index].add(type);
+		_updateQueries(index, type);
+
+		indexes.push_back(index);
+	}
+
+	_addComponents<T>(indexes, args...);
+
+	for (uint32_t index : indexes)
+		_stampAdded<T>(index);
+}
+
+template <typename SystemInterface, uint32_t maxComponents, typename ...Registries>
+template <typename T>
+T* SimpleEngine<SystemInterface, maxComponents, Registries...>::getComponent(uint64_t id) {
+	uint32_t index = front64(id);
+	uint32_t version = back64(id);
+
+	if (!_validId(index, version))
+		return nullptr;
+
+	uint32_t type = TypeMask::index<T>();
+
+	if (_componentPools[type] == nullptr)
+		return nullptr;
+
+	//assert(hasFlags(_flags[index], Identity::Active)); // sanity
+	assert(_flags[index] & Identity::Active); // sanity
+
+	if (!_masks[index].has<T>())
+		return nullptr;
+
+	return _pool<T>()->get(index);
+}
+
+template <typename SystemInterface, uint32_t maxComponents, typename ...Registries>
+template <typename T>
+const T* SimpleEngine<SystemInterface, maxComponents, Registries...>::getComponent(uint64_t id) const {
+	uint32_t index = front64(id);
+	uint32_t version = back64(id);
+
+	if (!_validId(index, version))
+		return nullptr;
+
+	uint32_t type = TypeMask::index<T>();
+
+	if (_componentPools[type] == nullptr)
+		return nullptr;
+
+	//assert(hasFlags(_flags[index], Identity::Active)); // sanity
+	assert(_flags[index] & Identity::Active); // sanity
+
+	if (!_masks[index].has<T>())
+		return nullptr;
+
+	return _pool<T>()->get(index);
+}
+
+template <typename SystemInterface, uint32_t maxComponents, typename ...Registries>
+template <typename T>
+void SimpleEngine<SystemInterface, maxComponents, Registries...>::markChanged(uint64_t id) {
+	uint32_t index = front64(id);
+	uint32_t version = back64(id);
+
+	if (!_validId(index, version) || !_masks[index].template has<T>())
+		return;
+
+	_pool<T>()->ticks(index)->changed = _tick;
+}
+
+template <typename SystemInterface, uint32_t maxComponents, typename ...Registries>
+template <typename T>
+void SimpleEngine<SystemInterface, maxComponents, Registries...>::removeComponent(uint64_t id) {
+	assert(!_parallel && "use commands() during parallelEach");
+
+	uint32_t index = front64(id);
+	uint32_t version = back64(id);
+
+	if (!_validId(index, version))
+		return;
+
+	uint32_t type = TypeMask::index<T>();
+
+	assert(_componentPools[type] != nullptr); // sanity
+	//assert(hasFlags(_flags[index], Identity::Active)); // sanity
+	assert(_flags[index] & Identity::Active); // sanity
+
+	// if removed during iteration, remove once done
+	if (_iterating) {
+		commands().template removeComponent<T>(id);
+		return;
+	}
+
+	_removeComponent(index, type);
+}
+
+template <typename SystemInterface, uint32_t maxComponents, typename ...Registries>
+template <typename ...Ts>
+bool SimpleEngine<SystemInterface, maxComponents, Registries...>::hasComponents(uint64_t id) const {
+	uint32_t index = front64(id);
+	uint32_t version = back64(id);
+
+	assert(_validId(index, version) && "calling has with invalid id");
+
+	if (!_validId(index, version))
+		return false;
+
+	//if (!hasFlags(_flags[index], Identity::Active))
+	//	return false;
+
+	if (!(_flags[index] & Identity::Active))
+		return false;
+
+	return _masks[index].has<Ts...>();
+}
+
+template <typename SystemInterface, uint32_t maxComponents, typename ...Registries>
+void SimpleEngine<SystemInterface, maxComponents, Registries...>::referenceEntity(uint64_t id) {
+	assert(!_parallel && "can't reference during parallelEach");
+
+	uint32_t index = front64(id);
+	uint32_t version = back64(id);
+
+	assert(_validId(index, version) && "calling reference with invalid id");
+
+	if (!_validId(index, version))
+		return;
+
+	//assert(hasFlags(_flags[index], Identity::Active)); // sanity
+	assert(_flags[index] & Identity::Active); // sanity
+
+	_references[index]++;
+}
+
+template <typename SystemInterface, uint32_t maxComponents, typename ...Registries>
+void SimpleEngine<SystemInterface, maxComponents, Registries...>::dereferenceEntity(uint64_t id) {
+	assert(!_parallel && "can't dereference during parallelEach");
+
+	uint32_t index = front64(id);
+	uint32_t version = back64(id);
+
+	assert(_validId(index, version) && "calling dereference with invalid id");
+
+	if (!_validId(index, version))
+		return;
+
+	//assert(hasFlags(_flags[index], Identity::Active)); // sanity;
+	assert(_flags[index] & Identity::Active); // sanity;
+
+	assert(_references[index] && "calling dereference with no more references");
+
+	if (!_references[index])
 		return;
 
-	Entity entity(*this);
-	entity.set(combine32(identity.index, identity.version));
+	_references[index]--;
+
+	//if (_references[index] == 0 && hasFlags(_flags[index], Identity::Destroyed))
+	//	_destroy(index);
+
+	if (_references[index] == 0 && _flags[index] & Identity::Destroyed)
+		_destroy(index);
+}
+
+template <typename SystemInterface, uint32_t maxComponents, typename ...Registries>
+uint32_t SimpleEngine<SystemInterface, maxComponents, Registries...>::tick() {
+	assert(!_parallel && "can't start a tick during parallelEach");
+	return _tick++;
+}
+
+template <typename SystemInterface, uint32_t maxComponents, typename ...Registries>
+bool SimpleEngine<SystemInterface, maxComponents, Registries...>::iterating() const {
+	return _iterating || _parallel;
+}
+
+template <typename SystemInterface, uint32_t maxComponents, typename ...Registries>
+void SimpleEngine<SystemInterface, maxComponents, Registries...>::highWater(size_t bytes) {
+	_highWater = bytes;
+
+	for (BasePool* pool : _componentPools) {
+		if (pool)
+			pool->highWater(bytes);
+	}
+}
+
+template <typename SystemInterface, uint32_t maxComponents, typename ...Registries>
+void SimpleEngine<SystemInterface, maxComponents, Registries...>::shrinkToFit() {
+	assert(!_parallel && "can't shrink during parallelEach");
+
+	for (BasePool* pool : _componentPools) {
+		if (pool)
+			pool->shrinkToFit();
+	}
+
+	_archetypes.shrinkToFit();
+}
+
+template <typename SystemInterface, uint32_t maxComponents, typename ...Registries>
+uint32_t SimpleEngine<SystemInterface, maxComponents, Registries...>::entityCount() const {
+	return _versions.size() - _freeIndexes.size();
+}
+
+template <typename SystemInterface, uint32_t maxComponents, typename ...Registries>
+template <typename ...Ts>
+typename SimpleEngine<SystemInterface, maxComponents, Registries...>::template Query<Ts...> SimpleEngine<SystemInterface, maxComponents, Registries...>::query() {
+	static_assert(sizeof...(Ts) > 0);
+
+	assert(!_parallel && "can't make a query during parallelEach");
+
+	const TypeMask mask = TypeMask::template create<typename std::remove_const<Ts>::type...>();
+
+	// queries with the same components share a cache
+	for (std::unique_ptr<QueryCache>& cache : _queries) {
+		if (cache->mask.has(mask) && mask.has(cache->mask))
+			return Query<Ts...>(*this, cache.get());
+	}
+
+	QueryCache* cache = new QueryCache();
+	cache->mask = mask;
+
+	_queries.emplace_back(cache);
+
+	for (uint32_t i = 0; i < maxComponents; i++) {
+		if (mask.has(i))
+			_typeQueries[i].push_back(cache);
+	}
+
+	// find entities which already match, after that it's kept up to date by adds and removes
+	_fillQuery(cache);
+
+	return Query<Ts...>(*this, cache);
+}
+
+template <typename SystemInterface, uint32_t maxComponents, typename ...Registries>
+bool SimpleEngine<SystemInterface, maxComponents, Registries...>::saveSnapshot(const std::string& path) const {
+	assert(!_iterating && !_parallel && "can't save during iteration");
+
+	TypeMask types;
+	_snapshotTypes(static_cast<ComponentRegistry*>(nullptr), &types);
+
+	// fail before touching the file if a component can't be saved
+	for (uint32_t i = 0; i < maxComponents; i++) {
+		if (!_componentPools[i] || types.has(i))
+			continue;
+
+		for (const TypeMask& mask : _masks) {
+			if (mask.has(i))
+				return false;
+		}
+	}
+
+	std::ofstream stream(path, std::ios::binary | std::ios::trunc);
+
+	if (!stream.is_open())
+		return false;
+
+	SnapshotHeader header = { _snapshotMagic, _snapshotVersion, maxComponents, sizeof(TypeMask), 0, 0, 0, 0 };
+
+	assert(_versions.size() <= UINT32_MAX);
+	header.entities = static_cast<uint32_t>(_versions.size());
+	header.freeIndexes = static_cast<uint32_t>(_freeIndexes.size());
+	header.components = 0;
+
+	for (uint32_t i = 0; i < maxComponents; i++)
+		header.components += types.has(i);
+
+	_writeSection(stream, &header, sizeof(SnapshotHeader));
+	_writeSection(stream, _versions.data(), _versions.size() * sizeof(uint32_t));
+	_writeSection(stream, _masks.data(), _masks.size() * sizeof(TypeMask));
+	_writeSection(stream, _flags.data(), _flags.size() * sizeof(uint8_t));
+	_writeSection(stream, _freeIndexes.data(), _freeIndexes.size() * sizeof(uint32_t));
+
+	_saveRegistered(static_cast<ComponentRegistry*>(nullptr), stream);
+
+	return stream.good();
+}
+
+template <typename SystemInterface, uint32_t maxComponents, typename ...Registries>
+bool SimpleEngine<SystemInterface, maxComponents, Registries...>::loadSnapshot(const std::string& path) {
+	assert(!_iterating && !_parallel && "can't load during iteration");
+	assert(!entityCount() && "snapshots are loaded into an engine with no entities");
+
+	MappedFile file(path);
+
+	if (!file.valid())
+		return false;
+
+	size_t offset = 0;
+
+	const SnapshotHeader* header = reinterpret_cast<const SnapshotHeader*>(_readSection(file, &offset, sizeof(SnapshotHeader)));
+
+	if (!header || header->magic != _snapshotMagic || header->version != _snapshotVersion)
+		return false;
+
+	if (header->width != maxComponents || header->maskSize != sizeof(TypeMask))
+		return false;
+
+	const uint32_t* versions = reinterpret_cast<const uint32_t*>(_readSection(file, &offset, header->entities * sizeof(uint32_t)));
+	const uint8_t* maskBytes = _readSection(file, &offset, header->entities * sizeof(TypeMask));
+	const uint8_t* flags = _readSection(file, &offset, header->entities * sizeof(uint8_t));
+	const uint32_t* freeIndexes = reinterpret_cast<const uint32_t*>(_readSection(file, &offset, header->freeIndexes * sizeof(uint32_t)));
 
-	lambda(entity);
-}
+	if (!versions || !maskBytes || !flags || !freeIndexes)
+		return false;
 
-template<typename SystemInterface, uint32_t maxComponents>
-template<typename T, typename ...Ts>
-typename std::enable_if<!std::is_constructible<T, SimpleEngine<SystemInterface, maxComponents>&, uint64_t, Ts...>::value>::type SimpleEngine<SystemInterface, maxComponents>::_addComponent(uint64_t id, Ts && ...args){
-	// construct component with provided args
-	_componentPools[TypeMask::index<T>()]->insert<T>(front64(id), std::forward<Ts>(args)...);
-}
+	// sections are only 8 byte aligned, so masks are copied out
+	std::vector<TypeMask> masks(header->entities);
+	memcpy(masks.data(), maskBytes, header->entities * sizeof(TypeMask));
 
-template<typename SystemInterface, uint32_t maxComponents>
-template<typename T, typename ...Ts>
-typename std::enable_if<std::is_constructible<T, SimpleEngine<SystemInterface, maxComponents>&, uint64_t, Ts...>::value>::type SimpleEngine<SystemInterface, maxComponents>::_addComponent(uint64_t id, Ts && ...args) {
-	// construct component with Engine object reference and its own ID, along with provided args
-	_componentPools[TypeMask::index<T>()]->insert<T>(front64(id), *this, id, std::forward<Ts>(args)...);
-}
+	// free indexes are reused by createEntity, so each must be a distinct inactive entity
+	std::vector<uint8_t> freed(header->entities, false);
 
-template <typename SystemInterface, uint32_t maxComponents>
-template<typename T, typename ...Ts>
-void SimpleEngine<SystemInterface, maxComponents>::registerSystem(Ts&&... args){
-	static_assert(std::is_base_of<BaseSystem, SystemInterface>::value);
-	static_assert(std::is_base_of<SystemInterface, T>::value);
+	for (uint32_t i = 0; i < header->freeIndexes; i++) {
+		if (freeIndexes[i] >= header->entities || flags[freeIndexes[i]] & Identity::Active || freed[freeIndexes[i]])
+			return false;
 
-	uint32_t index = typeIndex<SimpleEngine, T>();
+		freed[freeIndexes[i]] = true;
+	}
 
-	if (_systems.size() <= index)
-		_systems.resize(index + 1);
+	// check every record before changing anything
+	std::vector<SnapshotComponents> records(header->components);
+	TypeMask types;
+	TypeMask serialised;
 
-	assert(_systems[index] == nullptr);
+	for (SnapshotComponents& components : records) {
+		components.record = reinterpret_cast<const SnapshotRecord*>(_readSection(file, &offset, sizeof(SnapshotRecord)));
 
-	_systems[index] = new T(std::forward<Ts>(args)...);
-}
+		if (!components.record)
+			return false;
 
-template<typename SystemInterface, uint32_t maxComponents>
-template<typename T>
-bool SimpleEngine<SystemInterface, maxComponents>::hasSystem(){
-	uint32_t index = typeIndex<SimpleEngine, T>();
+		const SnapshotRecord& record = *components.record;
 
-	if (_systems.size() <= index)
-		return false;
+		if (types.has(record.type) || !_snapshotType(static_cast<ComponentRegistry*>(nullptr), record.type, record.size))
+			return false;
 
-	return _systems[index] != nullptr;
-}
+		components.indexes = reinterpret_cast<const uint32_t*>(_readSection(file, &offset, record.count * sizeof(uint32_t)));
+		components.offsets = nullptr;
 
-template <typename SystemInterface, uint32_t maxComponents>
-template<typename T>
-T& SimpleEngine<SystemInterface, maxComponents>::system(){
-	uint32_t index = typeIndex<SimpleEngine, T>();
+		if (!components.indexes)
+			return false;
 
-	if (_systems.size() <= index)
-		_systems.resize(index + 1);
+		size_t size = static_cast<size_t>(record.count) * record.size;
 
-	assert(_systems[index] != nullptr);
+		if (!record.size) {
+			components.offsets = reinterpret_cast<const uint32_t*>(_readSection(file, &offset, (static_cast<size_t>(record.count) + 1) * sizeof(uint32_t)));
 
-	return *static_cast<T*>(_systems[index]);
-}
+			if (!components.offsets || components.offsets[0])
+				return false;
 
-template <typename SystemInterface, uint32_t maxComponents>
-template <typename T, typename ...Ts>
-void SimpleEngine<SystemInterface, maxComponents>::callSystems(Ts&&... args) {
-	for (uint32_t i = 0; i < T::systemCount(); i++) {
-		(_systems[T::systemIndex(i)]->*T::functionPtr)(std::forward<Ts>(args)...);
-	}
-}
+			for (uint32_t i = 0; i < record.count; i++) {
+				if (components.offsets[i + 1] < components.offsets[i])
+					return false;
+			}
 
-template <typename SystemInterface, uint32_t maxComponents>
-bool SimpleEngine<SystemInterface, maxComponents>::running() const {
-	return _running;
-}
+			size = components.offsets[record.count];
+			serialised.add(record.type);
+		}
 
-template <typename SystemInterface, uint32_t maxComponents>
-void SimpleEngine<SystemInterface, maxComponents>::quit(){
-	_running = false;
-}
+		components.components = _readSection(file, &offset, size);
 
-template <typename SystemInterface, uint32_t maxComponents>
-uint64_t SimpleEngine<SystemInterface, maxComponents>::createEntity() {
-	// find free index
-	uint32_t index;
+		if (!components.components)
+			return false;
 
-	if (_freeIndexes.empty()) {
-		assert(_indexIdentities.size() <= UINT32_MAX);
-		index = static_cast<uint32_t>(_indexIdentities.size());
-		_indexIdentities.push_back({ index, 1 });
+		for (uint32_t i = 0; i < record.count; i++) {
+			if (components.indexes[i] >= header->entities || !masks[components.indexes[i]].has(record.type))
+				return false;
+		}
+
+		types.add(record.type);
 	}
-	else {
-		index = *_freeIndexes.rbegin();
-		_freeIndexes.pop_back();
+
+	for (uint32_t i = 0; i < header->entities; i++) {
+		if (!types.has(masks[i]))
+			return false;
 	}
 
-	// set identity flags to active
-	assert(!_indexIdentities[index].references); // sanity
-	//assert(!hasFlags(_indexIdentities[index].flags, Identity::Active)); // sanity
-	assert(!(_indexIdentities[index].flags & Identity::Active)); // sanity
+	_versions.assign(versions, versions + header->entities);
+	_masks.swap(masks);
+	_flags.assign(flags, flags + header->entities);
+	_references.assign(header->entities, 0);
+	_freeIndexes.assign(freeIndexes, freeIndexes + header->freeIndexes);
 
-	_indexIdentities[index].flags = Identity::Active;
+	// serialised components are added through the engine, so they start out missing
+	for (uint32_t i = 0; i < maxComponents; i++) {
+		if (!serialised.has(i))
+			continue;
 
-	// if made during iteration, buffer for later
-	if (_iterating) {
-		_indexIdentities[index].flags |= Identity::Buffered;
-		_bufferedIndexes.push_back(index);
+		for (TypeMask& mask : _masks)
+			mask.sub(i);
 	}
 
-	// return index and version combined
-	return combine32(index, _indexIdentities[index].version);
-}
+	_loadRegistered(static_cast<ComponentRegistry*>(nullptr), records);
 
-template <typename SystemInterface, uint32_t maxComponents>
-bool SimpleEngine<SystemInterface, maxComponents>::validEntity(uint64_t id) {
-	if (id == 0)
+	for (std::unique_ptr<QueryCache>& cache : _queries)
+		_fillQuery(cache.get());
+
+	if (!_deserialiseRegistered(static_cast<ComponentRegistry*>(nullptr), records))
 		return false;
 
-	uint32_t index = front64(id);
-	uint32_t version = back64(id);
+	// entities destroyed while still referenced, references aren't saved so they can go now
+	for (uint32_t i = 0; i < _versions.size(); i++) {
+		if (_flags[i] & Identity::Destroyed)
+			_destroy(i);
+	}
 
-	return _validId(index, version);
+	return true;
 }
 
-template <typename SystemInterface, uint32_t maxComponents>
-void SimpleEngine<SystemInterface, maxComponents>::destroyEntity(uint64_t id) {
-	uint32_t index = front64(id);
-	uint32_t version = back64(id);
+template <typename SystemInterface, uint32_t maxComponents, typename ...Registries>
+template <typename T, typename ...Ts>
+T& SimpleEngine<SystemInterface, maxComponents, Registries...>::resource(Ts&&... args) {
+	uint32_t index = typeIndex<BaseResource, T>();
 
-	assert(_validId(index, version) && "calling erase with invalid id");
+	if (_resources.size() <= index)
+		_resources.resize(index + 1);
 
-	if (!_validId(index, version))
-		return;
+	// can be used without args once made, even if it can't be made without them
+	if constexpr (std::is_constructible<T, Ts...>::value) {
+		if (!_resources[index]) {
+			assert(!_parallel && "can't make a resource during parallelEach");
+			_resources[index].reset(new Resource<T>(std::forward<Ts>(args)...));
+		}
+	}
 
-	_destroy(index);
+	assert(_resources[index] && "resource hasn't been made");
+
+	return static_cast<Resource<T>*>(_resources[index].get())->value;
 }
 
-template <typename SystemInterface, uint32_t maxComponents>
-template <typename T, typename ...Ts>
-T* SimpleEngine<SystemInterface, maxComponents>::addComponent(uint64_t id, Ts&&... args) {
-	//static_assert(std::is_constructible<T, Ts...>::value);
+template <typename SystemInterface, uint32_t maxComponents, typename ...Registries>
+template <typename T>
+bool SimpleEngine<SystemInterface, maxComponents, Registries...>::hasResource() const {
+	uint32_t index = typeIndex<BaseResource, T>();
 
-	uint32_t index = front64(id);
-	uint32_t version = back64(id);
+	return index < _resources.size() && _resources[index];
+}
 
-	assert(_validId(index, version) && "calling add with invalid id");
+template <typename SystemInterface, uint32_t maxComponents, typename ...Registries>
+template <typename T>
+void SimpleEngine<SystemInterface, maxComponents, Registries...>::iterateEntities(const T& lambda) {
+	_beginIterating();
 
-	if (!_validId(index, version))
-		return nullptr;
+	for (uint32_t i = 0; i < _versions.size(); i++) 
+		_iterate(i, lambda);
 
-	//assert(hasFlags(_indexIdentities[index].flags, Identity::Active)); // sanity
-	assert(_indexIdentities[index].flags & Identity::Active); // sanity
+	_endIterating();
+}
 
-	uint32_t type = TypeMask::index<T>();
+template <typename SystemInterface, uint32_t maxComponents, typename ...Registries>
+template <typename ...Ts, typename T, typename ...Fs>
+void SimpleEngine<SystemInterface, maxComponents, Registries...>::each(const T& lambda, const Fs&... filters) {
+	static_assert(sizeof...(Ts) > 0);
 
-	if (_indexIdentities[index].mask.has<T>())
-		return _componentPools[TypeMask::index<T>()]->get<T>(index);
+	// if a pool hasn't been made yet, nothing can match
+	if (!(_pool<Ts>() && ...))
+		return;
 
-	// update identity
-	_indexIdentities[index].mask.add<T>();
+	const TypeMask mask = TypeMask::template create<typename std::remove_const<Ts>::type...>();
 
-	// create pool if it doesn't exist
-	if (_componentPools[type] == nullptr)
-		_componentPools[type] = new ObjectPool<T>(_chunkSize);
+	// if any components are packed, walk the smallest packed pool instead of every entity
+	const std::vector<uint32_t>* packed = nullptr;
 
-	//_componentPools[TypeMask::index<T>()]->insert<T>(index, std::forward<Ts>(args)...);
+	((packed = _smallerIndexes(packed, _packedIndexes(_pool<Ts>()))), ...);
 
-	_addComponent<T>(id, std::forward<Ts>(args)...);
+	_beginIterating();
 
-	return _componentPools[TypeMask::index<T>()]->get<T>(index);
-}
+	if ((_archetypeStored<Ts>() || ...)) {
+		// if any components are stored in archetypes, only walk archetypes which have all of those
+		for (uint32_t i = 1; i < _archetypes.archetypeCount(); i++) {
+			Archetype& archetype = _archetypes.archetype(i);
 
-template <typename SystemInterface, uint32_t maxComponents>
-template <typename T>
-T* SimpleEngine<SystemInterface, maxComponents>::getComponent(uint64_t id) {
-	uint32_t index = front64(id);
-	uint32_t version = back64(id);
+			if (!((!_archetypeStored<Ts>() || archetype.has(TypeMask::template index<typename std::remove_const<Ts>::type>())) && ...))
+				continue;
 
-	if (!_validId(index, version))
-		return nullptr;
+			// backwards, so moving the current entity to another archetype doesn't skip the next
+			for (uint32_t row = archetype.size(); row > 0; row--) {
+				if (row <= archetype.size())
+					_eachRow<Ts...>(archetype, row - 1, mask, lambda, filters...);
+			}
+		}
+	}
+	else if (packed) {
+		// backwards, so erasing the current entity's components doesn't skip the next
+		for (uint32_t i = static_cast<uint32_t>(packed->size()); i > 0; i--) {
+			if (i <= packed->size())
+				_each<Ts...>((*packed)[i - 1], mask, lambda, filters...);
+		}
+	}
+	else {
+		_eachRange<Ts...>(0, static_cast<uint32_t>(_versions.size()), mask, lambda, filters...);
+	}
 
-	uint32_t type = TypeMask::index<T>();
+	_endIterating();
+}
 
-	if (_componentPools[type] == nullptr)
-		return nullptr;
+template <typename SystemInterface, uint32_t maxComponents, typename ...Registries>
+void SimpleEngine<SystemInterface, maxComponents, Registries...>::threads(uint32_t count) {
+	assert(!_parallel);
 
-	//assert(hasFlags(_indexIdentities[index].flags, Identity::Active)); // sanity
-	assert(_indexIdentities[index].flags & Identity::Active); // sanity
+	if (!count)
+		count = std::max(std::thread::hardware_concurrency(), 1u);
 
-	if (!_indexIdentities[index].mask.has<T>())
-		return nullptr;
+	_jobs.resize(count);
+	_commandBuffers.resize(count);
+	// kept where they are, as allocators point to them
+	while (_frameArenas.size() < count)
+		_frameArenas.emplace_back(new FrameArena());
 
-	return _componentPools[TypeMask::index<T>()]->get<T>(index);
+	_threaded = true;
 }
 
-template <typename SystemInterface, uint32_t maxComponents>
-template <typename T>
-const T* SimpleEngine<SystemInterface, maxComponents>::getComponent(uint64_t id) const {
-	uint32_t index = front64(id);
-	uint32_t version = back64(id);
+template <typename SystemInterface, uint32_t maxComponents, typename ...Registries>
+uint32_t SimpleEngine<SystemInterface, maxComponents, Registries...>::threadCount() const {
+	return _jobs.size();
+}
 
-	if (!_validId(index, version))
-		return nullptr;
+template <typename SystemInterface, uint32_t maxComponents, typename ...Registries>
+template <typename ...Ts, typename T, typename ...Fs>
+void SimpleEngine<SystemInterface, maxComponents, Registries...>::parallelEach(const T& lambda, uint32_t batchSize, const Fs&... filters) {
+	static_assert(sizeof...(Ts) > 0);
 
-	uint32_t type = TypeMask::index<T>();
+	assert(batchSize);
 
-	if (_componentPools[type] == nullptr)
-		return nullptr;
+	// already on a worker, e.g. from a system running in parallel, so walk on this thread instead
+	if (_parallel) {
+		each<Ts...>(lambda, filters...);
+		return;
+	}
 
-	//assert(hasFlags(_indexIdentities[index].flags, Identity::Active)); // sanity
-	assert(_indexIdentities[index].flags & Identity::Active); // sanity
+	if (!_threaded)
+		threads(0);
 
-	if (!_indexIdentities[index].mask.has<T>())
-		return nullptr;
+	// if a pool hasn't been made yet, nothing can match
+	if (!(_pool<Ts>() && ...))
+		return;
 
-	return _componentPools[TypeMask::index<T>()]->get<T>(index);
-}
+	// with one worker there's nothing to split across
+	if (_jobs.size() == 1) {
+		each<Ts...>(lambda, filters...);
+		return;
+	}
 
-template <typename SystemInterface, uint32_t maxComponents>
-template <typename T>
-void SimpleEngine<SystemInterface, maxComponents>::removeComponent(uint64_t id) {
-	uint32_t index = front64(id);
-	uint32_t version = back64(id);
+	const TypeMask mask = TypeMask::template create<typename std::remove_const<Ts>::type...>();
 
-	if (!_validId(index, version))
-		return;
+	const std::vector<uint32_t>* packed = nullptr;
 
-	uint32_t type = TypeMask::index<T>();
+	((packed = _smallerIndexes(packed, _packedIndexes(_pool<Ts>()))), ...);
 
-	assert(_componentPools[type] != nullptr); // sanity
-	//assert(hasFlags(_indexIdentities[index].flags, Identity::Active)); // sanity
-	assert(_indexIdentities[index].flags & Identity::Active); // sanity
+	// split whatever each would walk into batches, archetype 0 meaning packed indexes or every entity
+	struct Batch {
+		uint32_t archetype;
+		uint32_t begin;
+		uint32_t end;
+	};
+
+	std::vector<Batch> batches;
+
+	if ((_archetypeStored<Ts>() || ...)) {
+		for (uint32_t i = 1; i < _archetypes.archetypeCount(); i++) {
+			Archetype& archetype = _archetypes.archetype(i);
+
+			if (!((!_archetypeStored<Ts>() || archetype.has(TypeMask::template index<typename std::remove_const<Ts>::type>())) && ...))
+				continue;
+
+			for (uint32_t begin = 0; begin < archetype.size(); begin += batchSize)
+				batches.push_back({ i, begin, std::min(begin + batchSize, archetype.size()) });
+		}
+	}
+	else {
+		assert(_versions.size() <= UINT32_MAX);
+		uint32_t count = static_cast<uint32_t>(packed ? packed->size() : _versions.size());
 
-	if (!_indexIdentities[index].mask.has<T>())
+		for (uint32_t begin = 0; begin < count; begin += batchSize)
+			batches.push_back({ 0, begin, std::min(begin + batchSize, count) });
+	}
+
+	// a single batch isn't worth waking the other threads for
+	if (batches.size() <= 1) {
+		each<Ts...>(lambda, filters...);
 		return;
+	}
 
-	// remove from pool
-	_componentPools[type]->erase(index);
+	_parallel = true;
 
-	// update identity
-	_indexIdentities[index].mask.sub<T>();
+	_jobs.run(static_cast<uint32_t>(batches.size()), [&](uint32_t job, uint32_t) {
+		const Batch& batch = batches[job];
+
+		if (!batch.archetype && !packed) {
+			_eachRange<Ts...>(batch.begin, batch.end, mask, lambda, filters...);
+			return;
+		}
+
+		for (uint32_t i = batch.begin; i < batch.end; i++) {
+			if (batch.archetype)
+				_eachRow<Ts...>(_archetypes.archetype(batch.archetype), i, mask, lambda, filters...);
+			else
+				_each<Ts...>((*packed)[i], mask, lambda, filters...);
+		}
+	});
+
+	_parallel = false;
+
+	// apply structural changes recorded during the pass
+	_playback();
 }
 
-template <typename SystemInterface, uint32_t maxComponents>
+template <typename SystemInterface, uint32_t maxComponents, typename ...Registries>
 template <typename ...Ts>
-bool SimpleEngine<SystemInterface, maxComponents>::hasComponents(uint64_t id) const {
-	uint32_t index = front64(id);
-	uint32_t version = back64(id);
-
-	assert(_validId(index, version) && "calling has with invalid id");
+uint32_t SimpleEngine<SystemInterface, maxComponents, Registries...>::Query<Ts...>::size() const {
+	return static_cast<uint32_t>(_cache->indexes.size());
+}
 
-	if (!_validId(index, version))
-		return false;
+template <typename SystemInterface, uint32_t maxComponents, typename ...Registries>
+template <typename ...Ts>
+template <typename T, typename ...Fs>
+void SimpleEngine<SystemInterface, maxComponents, Registries...>::Query<Ts...>::each(const T& lambda, const Fs&... filters) {
+	const std::vector<uint32_t>& indexes = _cache->indexes;
 
-	//if (!hasFlags(_indexIdentities[index].flags, Identity::Active))
-	//	return false;
+	_engine._beginIterating();
 
-	if (!(_indexIdentities[index].flags & Identity::Active))
-		return false;
+	// backwards, so removing the current entity's components doesn't skip the next
+	for (uint32_t i = static_cast<uint32_t>(indexes.size()); i > 0; i--) {
+		if (i <= indexes.size())
+			_engine._each<Ts...>(indexes[i - 1], _cache->mask, lambda, filters...);
+	}
 
-	return _indexIdentities[index].mask.has<Ts...>();
+	_engine._endIterating();
 }
 
-template <typename SystemInterface, uint32_t maxComponents>
-void SimpleEngine<SystemInterface, maxComponents>::referenceEntity(uint64_t id) {
-	uint32_t index = front64(id);
-	uint32_t version = back64(id);
+template <typename SystemInterface, uint32_t maxComponents, typename ...Registries>
+template <typename ...Ts>
+template <typename T, typename ...Fs>
+void SimpleEngine<SystemInterface, maxComponents, Registries...>::Query<Ts...>::parallelEach(const T& lambda, uint32_t batchSize, const Fs&... filters) {
+	assert(batchSize);
 
-	assert(_validId(index, version) && "calling reference with invalid id");
+	// already on a worker, so walk on this thread instead
+	if (_engine._parallel) {
+		each(lambda, filters...);
+		return;
+	}
 
-	if (!_validId(index, version))
+	if (!_engine._threaded)
+		_engine.threads(0);
+
+	// structure can't change during the pass, so the cache can be split as is
+	const std::vector<uint32_t>& indexes = _cache->indexes;
+	uint32_t count = static_cast<uint32_t>(indexes.size());
+
+	// one worker or a single batch isn't worth waking the other threads for
+	if (_engine._jobs.size() == 1 || count <= batchSize) {
+		each(lambda, filters...);
 		return;
+	}
+
+	_engine._parallel = true;
+
+	_engine._jobs.run((count + batchSize - 1) / batchSize, [&](uint32_t job, uint32_t) {
+		uint32_t end = std::min(job * batchSize + batchSize, count);
+
+		for (uint32_t i = job * batchSize; i < end; i++)
+			_engine._each<Ts...>(indexes[i], _cache->mask, lambda, filters...);
+	});
 
-	//assert(hasFlags(_indexIdentities[index].flags, Identity::Active)); // sanity
-	assert(_indexIdentities[index].flags & Identity::Active); // sanity
+	_engine._parallel = false;
 
-	_indexIdentities[index].references++;
+	// apply structural changes recorded during the pass
+	_engine._playback();
 }
 
-template <typename SystemInterface, uint32_t maxComponents>
-void SimpleEngine<SystemInterface, maxComponents>::dereferenceEntity(uint64_t id) {
-	uint32_t index = front64(id);
-	uint32_t version = back64(id);
+template <typename SystemInterface, uint32_t maxComponents, typename ...Registries>
+template <typename T>
+void SimpleEngine<SystemInterface, maxComponents, Registries...>::parallelFor(uint32_t count, const T& lambda, uint32_t batchSize) {
+	assert(batchSize);
 
-	assert(_validId(index, version) && "calling dereference with invalid id");
+	// already on a worker, so walk on this thread instead
+	if (_parallel) {
+		if (count)
+			lambda(0u, count);
 
-	if (!_validId(index, version))
 		return;
+	}
 
-	//assert(hasFlags(_indexIdentities[index].flags, Identity::Active)); // sanity;
-	assert(_indexIdentities[index].flags & Identity::Active); // sanity;
+	if (!_threaded && count > batchSize)
+		threads(0);
 
-	assert(_indexIdentities[index].references && "calling dereference with no more references");
+	_parallel = true;
 
-	if (!_indexIdentities[index].references)
-		return;
+	// one worker or a single batch isn't worth waking the other threads for
+	if (count <= batchSize || _jobs.size() == 1) {
+		if (count)
+			lambda(0u, count);
+	}
+	else {
+		_jobs.run((count + batchSize - 1) / batchSize, [&](uint32_t job, uint32_t) {
+			lambda(job * batchSize, std::min(job * batchSize + batchSize, count));
+		});
+	}
 
-	_indexIdentities[index].references--;
+	_parallel = false;
 
-	//if (_indexIdentities[index].references == 0 && hasFlags(_indexIdentities[index].flags, Identity::Destroyed))
-	//	_destroy(index);
+	// apply structural changes recorded during the pass
+	_playback();
+}
 
-	if (_indexIdentities[index].references == 0 && _indexIdentities[index].flags & Identity::Destroyed)
-		_destroy(index);
+template <typename SystemInterface, uint32_t maxComponents, typename ...Registries>
+typename SimpleEngine<SystemInterface, maxComponents, Registries...>::CommandBuffer& SimpleEngine<SystemInterface, maxComponents, Registries...>::commands() {
+	assert(JobPool::worker() < _commandBuffers.size());
+	return _commandBuffers[JobPool::worker()];
 }
 
-template <typename SystemInterface, uint32_t maxComponents>
-uint32_t SimpleEngine<SystemInterface, maxComponents>::entityCount() const {
-	return (_indexIdentities.size() + _bufferedIndexes.size()) - _freeIndexes.size();
+template <typename SystemInterface, uint32_t maxComponents, typename ...Registries>
+FrameArena& SimpleEngine<SystemInterface, maxComponents, Registries...>::frameArena() {
+	assert(JobPool::worker() < _frameArenas.size());
+	return *_frameArenas[JobPool::worker()];
 }
 
-template <typename SystemInterface, uint32_t maxComponents>
-template <typename T>
-void SimpleEngine<SystemInterface, maxComponents>::iterateEntities(const T& lambda) {
-	_iterating = true;
+template <typename SystemInterface, uint32_t maxComponents, typename ...Registries>
+void SimpleEngine<SystemInterface, maxComponents, Registries...>::endFrame() {
+	assert(!_iterating && !_parallel && "can't end the frame during iteration");
 
-	for (uint32_t i = 0; i < _indexIdentities.size(); i++) 
-		_iterate(i, lambda);
+	for (std::unique_ptr<FrameArena>& arena : _frameArenas)
+		arena->reset();
+}
 
-	while (_bufferedIndexes.size()) {
-		_iterate(_bufferedIndexes[0], lambda);
-		_bufferedIndexes.erase(_bufferedIndexes.begin());
-	}
+template <typename SystemInterface, uint32_t maxComponents, typename ...Registries>
+uint64_t SimpleEngine<SystemInterface, maxComponents, Registries...>::frameHeapAllocations() const {
+	uint64_t count = 0;
+
+	for (const std::unique_ptr<FrameArena>& arena : _frameArenas)
+		count += arena->heapAllocations();
 
-	_iterating = false;
+	return count;
 }
 
-template <typename SystemInterface, uint32_t maxComponents>
-uint64_t SimpleEngine<SystemInterface, maxComponents>::Entity::id() const {
+template <typename SystemInterface, uint32_t maxComponents, typename ...Registries>
+uint64_t SimpleEngine<SystemInterface, maxComponents, Registries...>::Entity::id() const {
 	return _id;
 }
 
-template <typename SystemInterface, uint32_t maxComponents>
-void SimpleEngine<SystemInterface, maxComponents>::Entity::create() {
+template <typename SystemInterface, uint32_t maxComponents, typename ...Registries>
+void SimpleEngine<SystemInterface, maxComponents, Registries...>::Entity::create() {
 	if (_id)
 		invalidate();
 
@@ -625,8 +2457,8 @@ void SimpleEngine<SystemInterface, maxComponents>::Entity::create() {
 	_engine.referenceEntity(_id);
 }
 
-template <typename SystemInterface, uint32_t maxComponents>
-void SimpleEngine<SystemInterface, maxComponents>::Entity::destroy() {
+template <typename SystemInterface, uint32_t maxComponents, typename ...Registries>
+void SimpleEngine<SystemInterface, maxComponents, Registries...>::Entity::destroy() {
 	assert(_id);
 
 	if (!_id)
@@ -637,13 +2469,13 @@ void SimpleEngine<SystemInterface, maxComponents>::Entity::destroy() {
 	_id = 0;
 }
 
-template <typename SystemInterface, uint32_t maxComponents>
-bool SimpleEngine<SystemInterface, maxComponents>::Entity::valid() const {
+template <typename SystemInterface, uint32_t maxComponents, typename ...Registries>
+bool SimpleEngine<SystemInterface, maxComponents, Registries...>::Entity::valid() const {
 	return _id;
 }
 
-template <typename SystemInterface, uint32_t maxComponents>
-void SimpleEngine<SystemInterface, maxComponents>::Entity::invalidate() {
+template <typename SystemInterface, uint32_t maxComponents, typename ...Registries>
+void SimpleEngine<SystemInterface, maxComponents, Registries...>::Entity::invalidate() {
 	assert(_id);
 
 	if (!_id)
@@ -653,8 +2485,8 @@ void SimpleEngine<SystemInterface, maxComponents>::Entity::invalidate() {
 	_id = 0;
 }
 
-template<typename SystemInterface, uint32_t maxComponents>
-void SimpleEngine<SystemInterface, maxComponents>::Entity::set(uint64_t id){
+template<typename SystemInterface, uint32_t maxComponents, typename ...Registries>
+void SimpleEngine<SystemInterface, maxComponents, Registries...>::Entity::set(uint64_t id){
 	if (_id)
 		invalidate();
 
@@ -665,14 +2497,14 @@ void SimpleEngine<SystemInterface, maxComponents>::Entity::set(uint64_t id){
 	_engine.referenceEntity(_id);
 }
 
-template<typename SystemInterface, uint32_t maxComponents>
-SimpleEngine<SystemInterface, maxComponents>::Entity::operator uint64_t() const {
+template<typename SystemInterface, uint32_t maxComponents, typename ...Registries>
+SimpleEngine<SystemInterface, maxComponents, Registries...>::Entity::operator uint64_t() const {
 	return _id;
 }
 
-template <typename SystemInterface, uint32_t maxComponents>
+template <typename SystemInterface, uint32_t maxComponents, typename ...Registries>
 template <typename T, typename ...Ts>
-T* SimpleEngine<SystemInterface, maxComponents>::Entity::add(Ts&&... args) {
+T* SimpleEngine<SystemInterface, maxComponents, Registries...>::Entity::add(Ts&&... args) {
 	assert(_id);
 
 	if (!_id)
@@ -681,9 +2513,9 @@ T* SimpleEngine<SystemInterface, maxComponents>::Entity::add(Ts&&... args) {
 	return _engine.addComponent<T>(_id, std::forward<Ts>(args)...);
 }
 
-template <typename SystemInterface, uint32_t maxComponents>
+template <typename SystemInterface, uint32_t maxComponents, typename ...Registries>
 template <typename T>
-T* SimpleEngine<SystemInterface, maxComponents>::Entity::get() {
+T* SimpleEngine<SystemInterface, maxComponents, Registries...>::Entity::get() {
 	assert(_id);
 
 	if (!_id)
@@ -692,9 +2524,9 @@ T* SimpleEngine<SystemInterface, maxComponents>::Entity::get() {
 	return _engine.getComponent<T>(_id);
 }
 
-template <typename SystemInterface, uint32_t maxComponents>
+template <typename SystemInterface, uint32_t maxComponents, typename ...Registries>
 template <typename T>
-const T* SimpleEngine<SystemInterface, maxComponents>::Entity::get() const {
+const T* SimpleEngine<SystemInterface, maxComponents, Registries...>::Entity::get() const {
 	assert(_id);
 
 	if (!_id)
@@ -703,9 +2535,9 @@ const T* SimpleEngine<SystemInterface, maxComponents>::Entity::get() const {
 	return _engine.getComponent<T>(_id);
 }
 
-template <typename SystemInterface, uint32_t maxComponents>
+template <typename SystemInterface, uint32_t maxComponents, typename ...Registries>
 template <typename T>
-void SimpleEngine<SystemInterface, maxComponents>::Entity::remove() {
+void SimpleEngine<SystemInterface, maxComponents, Registries...>::Entity::remove() {
 	assert(_id);
 
 	if (!_id)
@@ -714,13 +2546,185 @@ void SimpleEngine<SystemInterface, maxComponents>::Entity::remove() {
 	_engine.removeComponent<T>(_id);
 }
 
-template <typename SystemInterface, uint32_t maxComponents>
+template <typename SystemInterface, uint32_t maxComponents, typename ...Registries>
 template <typename ...Ts>
-bool SimpleEngine<SystemInterface, maxComponents>::Entity::has() const {
+bool SimpleEngine<SystemInterface, maxComponents, Registries...>::Entity::has() const {
 	assert(_id);
 
 	if (!_id)
 		return false;
 
 	return _engine.hasComponents<Ts...>(_id);
+}
+
+template <typename SystemInterface, uint32_t maxComponents, typename ...Registries>
+template <typename T, typename ...Ts>
+void SimpleEngine<SystemInterface, maxComponents, Registries...>::CommandBuffer::Adds<T, Ts...>::playback(SimpleEngine& engine, const std::vector<uint64_t>& created, const std::vector<Change>& changes) {
+	const uint32_t type = TypeMask::template index<T>();
+
+	for (Add& command : commands)
+		command.id = _resolve(command.id, created);
+
+	// in index order, so pool memory is walked forwards
+	std::sort(commands.begin(), commands.end(), [](const Add& a, const Add& b) {
+		return front64(a.id) < front64(b.id);
+	});
+
+	for (Add& command : commands) {
+		if (!engine.validEntity(command.id) || !_applies(type, command.id, command.order, changes))
+			continue;
+
+		std::apply([&](Ts&... args) {
+			engine.addComponent<T>(command.id, std::move(args)...);
+		}, command.args);
+	}
+}
+
+template <typename SystemInterface, uint32_t maxComponents, typename ...Registries>
+uint64_t SimpleEngine<SystemInterface, maxComponents, Registries...>::CommandBuffer::_resolve(uint64_t id, const std::vector<uint64_t>& created) {
+	// pending ids have no version, and the created index plus one as their index
+	if (!id || back64(id))
+		return id;
+
+	assert(front64(id) <= created.size() && "pending id from another command buffer");
+
+	return created[front64(id) - 1];
+}
+
+template <typename SystemInterface, uint32_t maxComponents, typename ...Registries>
+bool SimpleEngine<SystemInterface, maxComponents, Registries...>::CommandBuffer::_before(const Change& a, const Change& b) {
+	if (a.type != b.type)
+		return a.type < b.type;
+
+	if (a.id != b.id)
+		return a.id < b.id;
+
+	return a.order < b.order;
+}
+
+template <typename SystemInterface, uint32_t maxComponents, typename ...Registries>
+bool SimpleEngine<SystemInterface, maxComponents, Registries...>::CommandBuffer::_applies(uint32_t type, uint64_t id, uint32_t order, const std::vector<Change>& changes) {
+	uint32_t first = UINT32_MAX;
+
+	// back from the entity's last change of the component, to its last remove
+	for (auto i = std::upper_bound(changes.begin(), changes.end(), Change{ type, UINT32_MAX, id, false }, _before); i != changes.begin();) {
+		--i;
+
+		if (i->type != type || i->id != id || i->remove)
+			break;
+
+		first = i->order;
+	}
+
+	return order == first;
+}
+
+template <typename SystemInterface, uint32_t maxComponents, typename ...Registries>
+uint64_t SimpleEngine<SystemInterface, maxComponents, Registries...>::CommandBuffer::createEntity() {
+	assert(_creates < UINT32_MAX);
+	_creates++;
+
+	return combine32(_creates, 0);
+}
+
+template <typename SystemInterface, uint32_t maxComponents, typename ...Registries>
+template <typename T>
+uint64_t SimpleEngine<SystemInterface, maxComponents, Registries...>::CommandBuffer::createEntity(const T& lambda) {
+	uint64_t id = createEntity();
+
+	_createCallbacks.push_back({ front64(id) - 1, lambda });
+
+	return id;
+}
+
+template <typename SystemInterface, uint32_t maxComponents, typename ...Registries>
+void SimpleEngine<SystemInterface, maxComponents, Registries...>::CommandBuffer::destroyEntity(uint64_t id) {
+	_destroys.push_back(id);
+}
+
+template <typename SystemInterface, uint32_t maxComponents, typename ...Registries>
+template <typename T, typename ...Ts>
+void SimpleEngine<SystemInterface, maxComponents, Registries...>::CommandBuffer::addComponent(uint64_t id, Ts&&... args) {
+	using List = Adds<T, typename std::decay<Ts>::type...>;
+
+	std::vector<std::unique_ptr<BaseAdds>>& lists = _adds[TypeMask::template index<T>()];
+
+	// find list for these argument types, usually the only one for the component type
+	List* list = nullptr;
+
+	for (uint32_t i = 0; i < lists.size() && !list; i++)
+		list = dynamic_cast<List*>(lists[i].get());
+
+	if (!list) {
+		list = new List();
+		lists.emplace_back(list);
+	}
+
+	assert(_changes.size() < UINT32_MAX);
+	uint32_t order = static_cast<uint32_t>(_changes.size());
+
+	list->commands.push_back({ id, order, std::tuple<typename std::decay<Ts>::type...>(std::forward<Ts>(args)...) });
+	_changes.push_back({ TypeMask::template index<T>(), order, id, false });
+}
+
+template <typename SystemInterface, uint32_t maxComponents, typename ...Registries>
+template <typename T>
+void SimpleEngine<SystemInterface, maxComponents, Registries...>::CommandBuffer::removeComponent(uint64_t id) {
+	assert(_changes.size() < UINT32_MAX);
+	_changes.push_back({ TypeMask::template index<T>(), static_cast<uint32_t>(_changes.size()), id, true });
+}
+
+template <typename SystemInterface, uint32_t maxComponents, typename ...Registries>
+bool SimpleEngine<SystemInterface, maxComponents, Registries...>::CommandBuffer::empty() const {
+	// every add is also a change
+	return !_creates && _changes.empty() && _destroys.empty() && _buffered.empty();
+}
+
+template <typename SystemInterface, uint32_t maxComponents, typename ...Registries>
+void SimpleEngine<SystemInterface, maxComponents, Registries...>::CommandBuffer::playback(SimpleEngine& engine) {
+	if (empty())
+		return;
+
+	// swapped out first, so commands recorded during playback are kept for next time
+	CommandBuffer commands;
+	std::swap(commands, *this);
+
+	// entities created directly during iteration can now be iterated
+	for (uint32_t index : commands._buffered)
+		engine._flags[index] &= ~Identity::Buffered;
+
+	std::vector<uint64_t> created(commands._creates);
+	engine.createEntities(commands._creates, created.data());
+
+	for (std::pair<uint32_t, std::function<void(uint64_t)>>& callback : commands._createCallbacks)
+		callback.second(created[callback.first]);
+
+	for (Change& change : commands._changes)
+		change.id = _resolve(change.id, created);
+
+	std::sort(commands._changes.begin(), commands._changes.end(), _before);
+
+	// removes before adds, as only adds after an entity's last remove are kept
+	for (const Change& change : commands._changes) {
+		if (change.remove && engine.validEntity(change.id))
+			engine._removeComponent(front64(change.id), change.type);
+	}
+
+	// adds grouped by component type
+	for (uint32_t i = 0; i < maxComponents; i++) {
+		for (std::unique_ptr<BaseAdds>& list : commands._adds[i])
+			list->playback(engine, created, commands._changes);
+	}
+
+	for (uint64_t& id : commands._destroys)
+		id = _resolve(id, created);
+
+	std::sort(commands._destroys.begin(), commands._destroys.end(), [](uint64_t a, uint64_t b) {
+		return front64(a) < front64(b);
+	});
+
+	for (uint64_t id : commands._destroys) {
+		if (engine.validEntity(id))
+			engine.destroyEntity(id);
+	}
 }
\ No newline at end of file
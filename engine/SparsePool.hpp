@@ -0,0 +1,222 @@
+#pragma once
+
+#include "ObjectPool.hpp"
+
+#include <cstdint>
+#include <cassert>
+#include <utility>
+#include <vector>
+#include <algorithm>
+#include <type_traits>
+
+// packed storage, a sparse array maps entity indexes to dense slots, alignment is as ObjectPool's
+template <typename T, size_t alignment = alignof(T)>
+class SparsePool : public ChunkPool {
+	static_assert(alignment >= alignof(T) && !(alignment & (alignment - 1)));
+
+	std::vector<uint32_t> _sparse; // entity index to dense slot + 1, 0 being empty
+	std::vector<uint32_t> _dense; // dense slot to entity index
+
+	inline T* _slot(uint32_t slot);
+
+public:
+	static constexpr size_t stride = (sizeof(T) + alignment - 1) / alignment * alignment;
+
+	inline SparsePool(size_t chunkSize);
+
+	inline T* get(uint32_t index);
+
+	inline T* at(uint32_t slot);
+
+	inline ChangeTicks* ticks(uint32_t index);
+
+	inline bool contains(uint32_t index) const;
+
+	template <typename ...Ts>
+	inline void insert(uint32_t index, Ts&&... args);
+
+	template <typename ...Ts>
+	inline void insertBatch(const uint32_t* indexes, uint32_t count, const Ts&... args);
+
+	// copies in count trivially copyable components, the nth going to indexes[n]
+	inline void load(const uint32_t* indexes, uint32_t count, const void* components);
+
+	inline void erase(uint32_t index) override;
+
+	inline void shrinkToFit() override;
+
+	inline uint32_t size() const;
+
+	inline const std::vector<uint32_t>& indexes() const;
+};
+
+template <typename T, size_t alignment>
+SparsePool<T, alignment>::SparsePool(size_t chunkSize) : ChunkPool(sizeof(T), alignment, chunkSize) { }
+
+template <typename T, size_t alignment>
+T* SparsePool<T, alignment>::_slot(uint32_t slot) {
+	assert(slot < _count);
+
+	return reinterpret_cast<T*>(_memory + static_cast<size_t>(slot) * stride);
+}
+
+template <typename T, size_t alignment>
+T* SparsePool<T, alignment>::get(uint32_t index) {
+	assert(contains(index));
+
+	return _slot(_sparse[index] - 1);
+}
+
+template <typename T, size_t alignment>
+T* SparsePool<T, alignment>::at(uint32_t slot) {
+	assert(slot < _dense.size());
+
+	return _slot(slot);
+}
+
+template <typename T, size_t alignment>
+ChangeTicks* SparsePool<T, alignment>::ticks(uint32_t index) {
+	assert(contains(index));
+
+	// kept by dense slot
+	return ChunkPool::ticks(_sparse[index] - 1);
+}
+
+template <typename T, size_t alignment>
+bool SparsePool<T, alignment>::contains(uint32_t index) const {
+	return index < _sparse.size() && _sparse[index];
+}
+
+template <typename T, size_t alignment>
+template <typename ...Ts>
+void SparsePool<T, alignment>::insert(uint32_t index, Ts&&... args) {
+	assert(!contains(index));
+	assert(_dense.size() < UINT32_MAX);
+
+	uint32_t slot = static_cast<uint32_t>(_dense.size());
+
+	if (index >= _sparse.size())
+		_sparse.resize(index + 1, 0);
+
+	ChunkPool::insert<T>(slot, std::forward<Ts>(args)...);
+
+	_sparse[index] = slot + 1;
+	_dense.push_back(index);
+}
+
+template <typename T, size_t alignment>
+template <typename ...Ts>
+void SparsePool<T, alignment>::insertBatch(const uint32_t* indexes, uint32_t count, const Ts&... args) {
+	if (!count)
+		return;
+
+	assert(_dense.size() + count <= UINT32_MAX);
+
+	uint32_t first = static_cast<uint32_t>(_dense.size());
+	uint32_t last = *std::max_element(indexes, indexes + count);
+
+	if (last >= _sparse.size())
+		_sparse.resize(last + 1, 0);
+
+	_dense.reserve(first + count);
+
+	// trivially copyable types are constructed once then copied, or zeroed if value initialising
+	if constexpr (std::is_trivially_copyable<T>::value) {
+		const T element = T(args...);
+		fill(first, count, sizeof...(Ts) == 0 && std::is_trivially_default_constructible<T>::value ? nullptr : &element);
+	}
+	else {
+		reserve(first + count - 1);
+
+		for (uint32_t i = 0; i < count; i++)
+			new(static_cast<void*>(_slot(first + i))) T(args...);
+
+		_track(first, count, true);
+	}
+
+	for (uint32_t i = 0; i < count; i++) {
+		assert(!contains(indexes[i]));
+
+		_sparse[indexes[i]] = first + i + 1;
+		_dense.push_back(indexes[i]);
+	}
+}
+
+template <typename T, size_t alignment>
+void SparsePool<T, alignment>::load(const uint32_t* indexes, uint32_t count, const void* components) {
+	static_assert(std::is_trivially_copyable<T>::value);
+
+	if (!count)
+		return;
+
+	assert(_dense.size() + count <= UINT32_MAX);
+
+	uint32_t first = static_cast<uint32_t>(_dense.size());
+	uint32_t last = *std::max_element(indexes, indexes + count);
+
+	if (last >= _sparse.size())
+		_sparse.resize(last + 1, 0);
+
+	_dense.reserve(first + count);
+
+	copy(first, count, components);
+
+	for (uint32_t i = 0; i < count; i++) {
+		assert(!contains(indexes[i]));
+
+		_sparse[indexes[i]] = first + i + 1;
+		_dense.push_back(indexes[i]);
+	}
+}
+
+template <typename T, size_t alignment>
+void SparsePool<T, alignment>::erase(uint32_t index) {
+	assert(contains(index));
+
+	uint32_t slot = _sparse[index] - 1;
+	uint32_t last = static_cast<uint32_t>(_dense.size() - 1);
+
+	T* element = _slot(slot);
+	element->~T();
+
+	// move last element into the gap to keep slots packed
+	if (slot != last) {
+		T* lastElement = _slot(last);
+
+		new(static_cast<void*>(element)) T(std::move(*lastElement));
+		lastElement->~T();
+
+		*ChunkPool::ticks(slot) = *ChunkPool::ticks(last);
+		_dense[slot] = _dense[last];
+		_sparse[_dense[slot]] = slot + 1;
+	}
+
+	_track(last, 1, false);
+
+	_dense.pop_back();
+	_sparse[index] = 0;
+}
+
+template <typename T, size_t alignment>
+void SparsePool<T, alignment>::shrinkToFit() {
+	ChunkPool::shrinkToFit();
+
+	size_t size = _sparse.size();
+
+	while (size && !_sparse[size - 1])
+		size--;
+
+	_sparse.resize(size);
+	_sparse.shrink_to_fit();
+	_dense.shrink_to_fit();
+}
+
+template <typename T, size_t alignment>
+uint32_t SparsePool<T, alignment>::size() const {
+	return static_cast<uint32_t>(_dense.size());
+}
+
+template <typename T, size_t alignment>
+const std::vector<uint32_t>& SparsePool<T, alignment>::indexes() const {
+	return _dense;
+}
\ No newline at end of file
@@ -0,0 +1,118 @@
+#pragma once
+
+#include "ObjectPool.hpp"
+
+#include <cstdint>
+#include <cassert>
+#include <vector>
+#include <type_traits>
+
+// empty types, only a mask bit and change ticks per entity, every entity shares one instance
+template <typename T>
+class TagPool : public BasePool {
+	static_assert(std::is_empty<T>::value && std::is_trivially_default_constructible<T>::value && std::is_trivially_destructible<T>::value);
+
+	T _tag;
+
+	std::vector<uint32_t> _sparse; // entity index to slot + 1, 0 being untagged
+	std::vector<uint32_t> _dense; // slot to entity index
+	std::vector<ChangeTicks> _ticks; // by slot
+
+	inline void _push(uint32_t index);
+
+public:
+	inline T* get(uint32_t index);
+
+	inline ChangeTicks* ticks(uint32_t index);
+
+	template <typename ...Ts>
+	inline void insert(uint32_t index, Ts&&... args);
+
+	template <typename ...Ts>
+	inline void insertBatch(const uint32_t* indexes, uint32_t count, const Ts&... args);
+
+	inline void load(const uint32_t* indexes, uint32_t count, const void* components);
+
+	inline void erase(uint32_t index) override;
+
+	inline void shrinkToFit() override;
+};
+
+template <typename T>
+void TagPool<T>::_push(uint32_t index) {
+	if (index >= _sparse.size())
+		_sparse.resize(index + 1, 0);
+
+	assert(!_sparse[index]);
+	assert(_dense.size() < UINT32_MAX);
+
+	_dense.push_back(index);
+	_ticks.emplace_back();
+
+	_sparse[index] = static_cast<uint32_t>(_dense.size());
+}
+
+template <typename T>
+T* TagPool<T>::get(uint32_t) {
+	return &_tag;
+}
+
+template <typename T>
+ChangeTicks* TagPool<T>::ticks(uint32_t index) {
+	assert(index < _sparse.size() && _sparse[index]);
+
+	return &_ticks[_sparse[index] - 1];
+}
+
+template <typename T>
+template <typename ...Ts>
+void TagPool<T>::insert(uint32_t index, Ts&&... args) {
+	// nothing is constructed
+	static_assert(sizeof...(Ts) == 0);
+
+	_push(index);
+}
+
+template <typename T>
+template <typename ...Ts>
+void TagPool<T>::insertBatch(const uint32_t* indexes, uint32_t count, const Ts&... args) {
+	static_assert(sizeof...(Ts) == 0);
+
+	for (uint32_t i = 0; i < count; i++)
+		_push(indexes[i]);
+}
+
+template <typename T>
+void TagPool<T>::load(const uint32_t* indexes, uint32_t count, const void*) {
+	for (uint32_t i = 0; i < count; i++)
+		_push(indexes[i]);
+}
+
+template <typename T>
+void TagPool<T>::erase(uint32_t index) {
+	assert(index < _sparse.size() && _sparse[index]);
+
+	uint32_t slot = _sparse[index] - 1;
+
+	// move last into the gap to keep slots packed
+	_dense[slot] = _dense.back();
+	_ticks[slot] = _ticks.back();
+	_sparse[_dense[slot]] = slot + 1;
+
+	_dense.pop_back();
+	_ticks.pop_back();
+	_sparse[index] = 0;
+}
+
+template <typename T>
+void TagPool<T>::shrinkToFit() {
+	size_t size = _sparse.size();
+
+	while (size && !_sparse[size - 1])
+		size--;
+
+	_sparse.resize(size);
+	_sparse.shrink_to_fit();
+	_dense.shrink_to_fit();
+	_ticks.shrink_to_fit();
+}
\ No newline at end of file
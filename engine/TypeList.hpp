@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstdint>
+#include <type_traits>
+
+// Compile time list of types, a type's index being its position in the list.
+template <typename ...Ts>
+struct TypeList {
+	static constexpr uint32_t size = sizeof...(Ts);
+
+	template <typename T>
+	inline static constexpr bool contains() {
+		return (std::is_same<T, Ts>::value || ...);
+	}
+
+	template <typename T>
+	inline static constexpr uint32_t index() {
+		static_assert(contains<T>(), "type not in list");
+
+		constexpr bool matches[] = { false, std::is_same<T, Ts>::value... };
+
+		uint32_t i = 0;
+
+		while (!matches[i + 1])
+			i++;
+
+		return i;
+	}
+};
+
+// registries optionally given to SimpleEngine after maxComponents, listed types get constant ids and can be forward declared
+template <typename ...Ts>
+struct Components : TypeList<Ts...> {};
+
+template <typename ...Ts>
+struct Systems : TypeList<Ts...> {};
+
+// whether T is complete, checked once per Key, so a Key made at the use site checks it there
+template <typename T, typename Key, typename = void>
+struct IsComplete : std::false_type {};
+
+template <typename T, typename Key>
+struct IsComplete<T, Key, std::void_t<decltype(sizeof(T))>> : std::true_type {};
+
+// Finds the registry made from Registry among Ts, or an empty one.
+template <template <typename...> class Registry, typename ...Ts>
+struct FindRegistry {
+	using type = Registry<>;
+};
+
+template <template <typename...> class Registry, typename ...Rs, typename ...Ts>
+struct FindRegistry<Registry, Registry<Rs...>, Ts...> {
+	using type = Registry<Rs...>;
+};
+
+template <template <typename...> class Registry, typename T, typename ...Ts>
+struct FindRegistry<Registry, T, Ts...> {
+	using type = typename FindRegistry<Registry, Ts...>::type;
+};
\ No newline at end of file
@@ -1,15 +1,32 @@
 #pragma once
 
 #include "Utility.hpp"
+#include "TypeList.hpp"
 
 #include <cstdint>
-#include <bitset>
 #include <type_traits>
 #include <cassert>
 
-template <size_t width>
+// wide masks are compared a vector at a time where available
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define TYPEMASK_AVX2
+#endif
+
+#if defined(__SSE4_1__) || defined(__AVX__)
+#include <smmintrin.h>
+#define TYPEMASK_SSE41
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define TYPEMASK_SSE2
+#endif
+
+// bits in 64 bit words, aligned for vector loads, Registry's types get constant indexes and others come after
+template <size_t width, typename Registry = TypeList<>>
 class TypeMask {
-	std::bitset<width> _mask;
+	static constexpr uint32_t _words = static_cast<uint32_t>((width + 63) / 64);
+
+	alignas(_words >= 4 ? 32 : _words >= 2 ? 16 : 8) uint64_t _mask[_words] = {};
 
 	template <uint32_t i, typename ...Ts>
 	inline typename std::enable_if<i == sizeof...(Ts), void>::type _fill(bool value);
@@ -18,10 +35,12 @@ class TypeMask {
 	inline typename std::enable_if < i < sizeof...(Ts), void>::type _fill(bool value);
 
 public:
-	inline TypeMask<width>& operator=(const TypeMask<width>& other);
+	// trivially copyable, so masks can be copied as bytes
+	inline TypeMask<width, Registry>& operator=(const TypeMask<width, Registry>& other) = default;
 
+	// constant for registered types
 	template <typename T>
-	inline static uint32_t index();
+	inline static constexpr uint32_t index();
 
 	template <typename ...Ts>
 	inline void fill();
@@ -41,102 +60,209 @@ public:
 
 	inline bool has(uint32_t i) const;
 
+	inline bool has(const TypeMask<width, Registry>& other) const;
+
+	// bit i set if masks[i] has all of other's bits, up to 64 masks
+	inline static uint64_t hasEach(const TypeMask<width, Registry>* masks, uint32_t count, const TypeMask<width, Registry>& other);
+
+	inline bool overlaps(const TypeMask<width, Registry>& other) const;
+
 	inline bool empty() const;
 
 	inline void clear();
 
 	template <typename ...Ts>
-	inline static TypeMask<width> create();
+	inline static TypeMask<width, Registry> create();
 };
 
-template <size_t width>
+template <size_t width, typename Registry>
 template <uint32_t i, typename ...Ts>
-typename std::enable_if<i == sizeof...(Ts), void>::type TypeMask<width>::_fill(bool value) { }
+typename std::enable_if<i == sizeof...(Ts), void>::type TypeMask<width, Registry>::_fill(bool) { }
 
-template <size_t width>
+template <size_t width, typename Registry>
 template <uint32_t i, typename ...Ts>
-typename std::enable_if<i < sizeof...(Ts), void>::type TypeMask<width>::_fill(bool value) {
+typename std::enable_if<i < sizeof...(Ts), void>::type TypeMask<width, Registry>::_fill(bool value) {
 	_fill<i + 1, Ts...>(value);
 
 	using T = typename std::tuple_element<i, std::tuple<Ts...>>::type;
-	_mask.set(typeIndex<TypeMask, T>(), value);
-}
 
-template <size_t width>
-TypeMask<width>& TypeMask<width>::operator=(const TypeMask<width>& other) {
-	_mask = other._mask;
-	return *this;
+	if (value)
+		add(index<T>());
+	else
+		sub(index<T>());
 }
 
-template<size_t width>
+template<size_t width, typename Registry>
 template<typename T>
-inline uint32_t TypeMask<width>::index(){
-	return typeIndex<TypeMask, T>();
+constexpr uint32_t TypeMask<width, Registry>::index(){
+	if constexpr (Registry::template contains<T>())
+		return Registry::template index<T>();
+	else
+		return Registry::size + typeIndex<TypeMask, T>();
 }
 
-template <size_t width>
+template <size_t width, typename Registry>
 template <typename ...Ts>
-void TypeMask<width>::fill() {
-	_mask.reset();
+void TypeMask<width, Registry>::fill() {
+	clear();
 	_fill<0, Ts...>(true);
 }
 
-template <size_t width>
+template <size_t width, typename Registry>
 template <typename ...Ts>
-void TypeMask<width>::add() {
+void TypeMask<width, Registry>::add() {
 	_fill<0, Ts...>(true);
 }
 
-template <size_t width>
+template <size_t width, typename Registry>
 template <typename ...Ts>
-void TypeMask<width>::sub() {
+void TypeMask<width, Registry>::sub() {
 	_fill<0, Ts...>(false);
 }
 
-template <size_t width>
+template <size_t width, typename Registry>
 template <typename ...Ts>
-bool TypeMask<width>::has() const {
-	TypeMask<width> other = create<Ts...>();
-
-	unsigned long check = other._mask.to_ulong();
-	return (_mask.to_ulong() & check) == check;
+bool TypeMask<width, Registry>::has() const {
+	// a bit at a time rather than building a mask, registered types' bits being constant
+	return (has(index<Ts>()) && ...);
 }
 
-template<size_t width>
-inline void TypeMask<width>::add(uint32_t i){
+template<size_t width, typename Registry>
+inline void TypeMask<width, Registry>::add(uint32_t i){
 	if (i >= width)
 		return;
 
-	_mask[i] = true;
+	_mask[i / 64] |= uint64_t(1) << (i % 64);
 }
 
-template<size_t width>
-inline void TypeMask<width>::sub(uint32_t i){
+template<size_t width, typename Registry>
+inline void TypeMask<width, Registry>::sub(uint32_t i){
 	if (i >= width)
 		return;
 
-	_mask[i] = false;
+	_mask[i / 64] &= ~(uint64_t(1) << (i % 64));
 }
 
-template<size_t width>
-bool TypeMask<width>::has(uint32_t i) const {
-	return _mask[i];
+template<size_t width, typename Registry>
+bool TypeMask<width, Registry>::has(uint32_t i) const {
+	if (i >= width)
+		return false;
+
+	return (_mask[i / 64] >> (i % 64)) & 1;
 }
 
-template <size_t width>
-bool TypeMask<width>::empty() const {
-	return _mask.to_ulong() == 0;
+template<size_t width, typename Registry>
+bool TypeMask<width, Registry>::has(const TypeMask<width, Registry>& other) const {
+	// without branching per word, as this is checked for every entity when iterating
+	bool result = true;
+	uint32_t i = 0;
+
+#ifdef TYPEMASK_AVX2
+	for (; i + 4 <= _words; i += 4) {
+		__m256i mask = _mm256_load_si256(reinterpret_cast<const __m256i*>(_mask + i));
+		__m256i check = _mm256_load_si256(reinterpret_cast<const __m256i*>(other._mask + i));
+
+		result &= _mm256_testc_si256(mask, check) != 0; // no bits of check missing from mask
+	}
+#endif
+
+#if defined(TYPEMASK_SSE41)
+	for (; i + 2 <= _words; i += 2) {
+		__m128i mask = _mm_load_si128(reinterpret_cast<const __m128i*>(_mask + i));
+		__m128i check = _mm_load_si128(reinterpret_cast<const __m128i*>(other._mask + i));
+
+		result &= _mm_testc_si128(mask, check) != 0;
+	}
+#elif defined(TYPEMASK_SSE2)
+	for (; i + 2 <= _words; i += 2) {
+		__m128i mask = _mm_load_si128(reinterpret_cast<const __m128i*>(_mask + i));
+		__m128i check = _mm_load_si128(reinterpret_cast<const __m128i*>(other._mask + i));
+
+		result &= _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(mask, check), check)) == 0xffff;
+	}
+#endif
+
+	for (; i < _words; i++)
+		result &= (_mask[i] & other._mask[i]) == other._mask[i];
+
+	return result;
+}
+
+template<size_t width, typename Registry>
+uint64_t TypeMask<width, Registry>::hasEach(const TypeMask<width, Registry>* masks, uint32_t count, const TypeMask<width, Registry>& other) {
+	assert(count <= 64);
+
+	uint64_t result = 0;
+	uint32_t i = 0;
+
+	// single word masks, several to a vector
+#if defined(TYPEMASK_AVX2) || defined(TYPEMASK_SSE41)
+	if constexpr (_words == 1) {
+		static_assert(sizeof(TypeMask<width, Registry>) == sizeof(uint64_t));
+
+		const uint64_t* words = masks->_mask;
+
+#ifdef TYPEMASK_AVX2
+		const __m256i check4 = _mm256_set1_epi64x(static_cast<long long>(other._mask[0]));
+
+		for (; i + 4 <= count; i += 4) {
+			__m256i mask = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(words + i));
+			__m256i equal = _mm256_cmpeq_epi64(_mm256_and_si256(mask, check4), check4);
+
+			result |= static_cast<uint64_t>(_mm256_movemask_pd(_mm256_castsi256_pd(equal))) << i;
+		}
+#endif
+
+		// sse2 has no 64 bit compare, and two masks at a time isn't worth working around that for
+#ifdef TYPEMASK_SSE41
+		const __m128i check2 = _mm_set1_epi64x(static_cast<long long>(other._mask[0]));
+
+		for (; i + 2 <= count; i += 2) {
+			__m128i mask = _mm_loadu_si128(reinterpret_cast<const __m128i*>(words + i));
+			__m128i equal = _mm_cmpeq_epi64(_mm_and_si128(mask, check2), check2);
+
+			result |= static_cast<uint64_t>(_mm_movemask_pd(_mm_castsi128_pd(equal))) << i;
+		}
+#endif
+	}
+#endif
+
+	for (; i < count; i++)
+		result |= static_cast<uint64_t>(masks[i].has(other)) << i;
+
+	return result;
+}
+
+template<size_t width, typename Registry>
+bool TypeMask<width, Registry>::overlaps(const TypeMask<width, Registry>& other) const {
+	uint64_t overlap = 0;
+
+	for (uint32_t i = 0; i < _words; i++)
+		overlap |= _mask[i] & other._mask[i];
+
+	return overlap != 0;
+}
+
+template <size_t width, typename Registry>
+bool TypeMask<width, Registry>::empty() const {
+	uint64_t any = 0;
+
+	for (uint32_t i = 0; i < _words; i++)
+		any |= _mask[i];
+
+	return any == 0;
 }
 
-template<size_t width>
-void TypeMask<width>::clear() {
-	_mask = 0;
+template<size_t width, typename Registry>
+void TypeMask<width, Registry>::clear() {
+	for (uint32_t i = 0; i < _words; i++)
+		_mask[i] = 0;
 }
 
-template <size_t width>
+template <size_t width, typename Registry>
 template <typename ...Ts>
-TypeMask<width> TypeMask<width>::create() {
-	TypeMask<width> mask;
+TypeMask<width, Registry> TypeMask<width, Registry>::create() {
+	TypeMask<width, Registry> mask;
 	mask.fill<Ts...>();
 
 	return mask;
@@ -8,6 +8,10 @@
 #include <string>
 #include <fstream>
 
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
 using Clock = std::chrono::high_resolution_clock;
 using TimePoint = Clock::time_point;
 
@@ -23,6 +27,18 @@ inline uint64_t combine32(uint32_t front, uint32_t back) {
 	return static_cast<uint64_t>(back) + (static_cast<uint64_t>(front) << 32);
 }
 
+// index of the lowest set bit, bits can't be 0
+inline uint32_t lowestBit(uint64_t bits) {
+#ifdef _MSC_VER
+	unsigned long index;
+	_BitScanForward64(&index, bits);
+
+	return index;
+#else
+	return __builtin_ctzll(bits);
+#endif
+}
+
 //inline bool hasFlags(uint8_t target, uint8_t check) {
 //	return (target & check) == check;
 //}
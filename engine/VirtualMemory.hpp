@@ -0,0 +1,94 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+// address space reserved separately from committing memory to it
+
+#ifdef _WIN32
+inline size_t pageSize() {
+	static const size_t size = [] {
+		SYSTEM_INFO info;
+		GetSystemInfo(&info);
+		return static_cast<size_t>(info.dwPageSize);
+	}();
+
+	return size;
+}
+
+// reserves size bytes of address space with no access, null if it couldn't
+inline uint8_t* reserveMemory(size_t size) {
+	return static_cast<uint8_t*>(VirtualAlloc(nullptr, size, MEM_RESERVE, PAGE_NOACCESS));
+}
+
+// commits size bytes from address, which must be page aligned and within a reserved range
+inline bool commitMemory(uint8_t* address, size_t size) {
+	return VirtualAlloc(address, size, MEM_COMMIT, PAGE_READWRITE) != nullptr;
+}
+
+// drops the contents of committed pages, giving their memory back, they stay usable and read as zero
+inline void discardMemory(uint8_t* address, size_t size) {
+	VirtualFree(address, size, MEM_DECOMMIT);
+	VirtualAlloc(address, size, MEM_COMMIT, PAGE_READWRITE);
+}
+
+// gives committed pages back, they can't be used until committed again
+inline void decommitMemory(uint8_t* address, size_t size) {
+	VirtualFree(address, size, MEM_DECOMMIT);
+}
+
+// releases a whole range returned by reserveMemory
+inline void releaseMemory(uint8_t* address, size_t size) {
+	VirtualFree(address, 0, MEM_RELEASE);
+}
+#else
+inline size_t pageSize() {
+	static const size_t size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+	return size;
+}
+
+inline uint8_t* reserveMemory(size_t size) {
+	void* address = mmap(nullptr, size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+
+	if (address == MAP_FAILED)
+		return nullptr;
+
+	return static_cast<uint8_t*>(address);
+}
+
+inline bool commitMemory(uint8_t* address, size_t size) {
+	return mprotect(address, size, PROT_READ | PROT_WRITE) == 0;
+}
+
+inline void discardMemory(uint8_t* address, size_t size) {
+	madvise(address, size, MADV_DONTNEED);
+}
+
+inline void decommitMemory(uint8_t* address, size_t size) {
+	// mapping over the pages drops them and their commit charge
+	mmap(address, size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_FIXED, -1, 0);
+}
+
+inline void releaseMemory(uint8_t* address, size_t size) {
+	munmap(address, size);
+}
+#endif
+
+// rounds size up to a whole number of pages
+inline size_t pageAlign(size_t size) {
+	size_t page = pageSize();
+	return (size + page - 1) / page * page;
+}
\ No newline at end of file
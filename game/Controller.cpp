@@ -4,7 +4,7 @@
 #include "Window.hpp"
 
 Controller::Controller(Engine& engine) : _engine(engine), _possessed(engine) {
-	SYSFUNC_ENABLE(SystemInterface, update, 0);
+	SYSFUNC_ENABLE(SystemInterface, update, 0).writes<Transform>();
 
 	SYSFUNC_ENABLE(SystemInterface, cursorPosition, 0);
 	SYSFUNC_ENABLE(SystemInterface, keyInput, 0);
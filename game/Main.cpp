@@ -1,6 +1,7 @@
 #include "SystemInterface.hpp"
 
 #include "Transform.hpp"
+#include "TransformSystem.hpp"
 
 #include "Window.hpp"
 #include "Renderer.hpp"
@@ -19,20 +20,21 @@
 /*
 	- make uv interpolation a per triangle function, and run for entire scene
 	- fix hierarchical scaling
-	- prevent multiple loading of same meshes/hierarchies in renderer
 */
 
 void recursivelySetTexture(SystemInterface::Engine& engine, uint64_t id, GLuint textureBufferId) {
 	Transform* transform = engine.getComponent<Transform>(id);
 	Model* model = engine.getComponent<Model>(id);
 
-	if (model)
+	if (model) {
 		model->textureBufferId = textureBufferId;
+		engine.markChanged<Model>(id);
+	}
 
 	if (!transform || !transform->hasChildren())
 		return;
 
-	std::vector<uint64_t> children;
+	FrameVector<uint64_t> children(engine.frameArena());
 	transform->getChildren(&children);
 
 	for (uint64_t i : children)
@@ -50,7 +52,7 @@ uint64_t recursivelyFindName(SystemInterface::Engine& engine, uint64_t id, const
 	if (!transform || !transform->hasChildren())
 		return 0;
 
-	std::vector<uint64_t> children;
+	FrameVector<uint64_t> children(engine.frameArena());
 	transform->getChildren(&children);
 
 	for (uint64_t i : children) {
@@ -77,18 +79,18 @@ uint64_t createAxis(SystemInterface::Engine& engine, const std::string& path, co
 
 	Transform& transform = *engine.addComponent<Transform>(id);
 
-	transform.position = position;
-	transform.rotation = rotation;
-	transform.scale = { 0.01f, 0.01f, 0.05f };
+	transform.setPosition(position);
+	transform.setRotation(rotation);
+	transform.setScale({ 0.01f, 0.01f, 0.05f });
 
 	transform.localTranslate(Transform::localForward * 0.5f); // poke the arrow through the mesh
 
 	Renderer& renderer = engine.system<Renderer>();
 
-	// although programs and textures aren't loaded mulitple times in the renderer, meshes currently are, so for testing and speed I'm storing them as static
-	static uint32_t program = renderer.loadProgram(path + "vertexShader.glsl", path + "fragmentShader.glsl");
-	static uint32_t mesh = renderer.loadMesh(path + "arrow.obj");
-	static GLuint texture = renderer.loadTexture(path + "arrow.png");
+	// programs, textures and meshes are only loaded once in the renderer
+	uint32_t program = renderer.loadProgram(path + "vertexShader.glsl", path + "fragmentShader.glsl");
+	uint32_t mesh = renderer.loadMesh(path + "arrow.obj");
+	GLuint texture = renderer.loadTexture(path + "arrow.png");
 
 	Model& model = *engine.addComponent<Model>(id);
 
@@ -100,7 +102,7 @@ uint64_t createAxis(SystemInterface::Engine& engine, const std::string& path, co
 }
 
 int main(int argc, char** argv) {
-	SystemInterface::Engine engine(1024 * 1024 * 128); // 128 KB
+	SystemInterface::Engine engine(1024 * 1024 * 128); // 128 MB
 
 	Window::ConstructorInfo windowInfo;
 	Renderer::ConstructorInfo rendererInfo;
@@ -108,6 +110,7 @@ int main(int argc, char** argv) {
 	engine.registerSystem<Window>(engine, windowInfo);
 	engine.registerSystem<Controller>(engine);
 	engine.registerSystem<Renderer>(engine, rendererInfo);
+	engine.registerSystem<TransformSystem>(engine);
 
 	SYSFUNC_CALL(SystemInterface, initiate, engine)(std::vector<std::string>(argv, argv + argc));
 
@@ -140,8 +143,8 @@ int main(int argc, char** argv) {
 			uint64_t id = engine.createEntity();
 
 			Transform& transform = *engine.addComponent<Transform>(id);
-			transform.position = { 0.f, -100.f, 100.f };
-			transform.rotation = glm::quat({ glm::radians(90.f), 0.f, 0.f });
+			transform.setPosition({ 0.f, -100.f, 100.f });
+			transform.setRotation(glm::quat({ glm::radians(90.f), 0.f, 0.f }));
 
 			renderer.setCamera(id);
 			controller.setPossessed(id);
@@ -154,8 +157,8 @@ int main(int argc, char** argv) {
 			uint64_t id = engine.createEntity();
 			
 			Transform& transform = *engine.addComponent<Transform>(id);
-			transform.rotation = glm::quat({ glm::radians(90.f) , 0.f, 0.f });
-			//transform.scale = { 10.f, 10.f, 10.f };
+			transform.setRotation(glm::quat({ glm::radians(90.f) , 0.f, 0.f }));
+			//transform.setScale({ 10.f, 10.f, 10.f });
 		
 			renderer.loadMesh(path + "triangle_test_crooked.fbx", id);
 
@@ -168,7 +171,7 @@ int main(int argc, char** argv) {
 			uint64_t id = engine.createEntity();
 			
 			Transform& transform = *engine.addComponent<Transform>(id);
-			transform.scale = { 1000.f, 1000.f, 1000.f };
+			transform.setScale({ 1000.f, 1000.f, 1000.f });
 			
 			renderer.loadMesh(path + "skybox.obj", id);
 			recursivelySetTexture(engine, id, renderer.loadTexture(path + "skybox.png"));
@@ -186,7 +189,8 @@ int main(int argc, char** argv) {
 
 		Transform* triangleTransform = engine.getComponent<Transform>(triangleEntity);
 
-		glm::mat4 triangleModelMatrix = triangleTransform->globalMatrix();
+		// before the first transform pass
+		glm::mat4 triangleModelMatrix = triangleTransform->updateGlobalMatrix();
 
 		glm::quat triangleRotation;
 		glm::decompose(triangleModelMatrix, glm::vec3(), triangleRotation, glm::vec3(), glm::vec3(), glm::vec4());
@@ -257,6 +261,9 @@ int main(int argc, char** argv) {
 		SYSFUNC_CALL(SystemInterface, update, engine)(dt);
 		SYSFUNC_CALL(SystemInterface, lateUpdate, engine)(dt);
 
+		// frame memory is kept across both calls
+		engine.endFrame();
+
 		dt = deltaTime(timer);
 	}
 	
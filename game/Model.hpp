@@ -0,0 +1,60 @@
+#pragma once
+
+#include "SystemInterface.hpp"
+
+#include <glad\glad.h>
+
+#include <string>
+#include <vector>
+#include <cstring>
+
+struct Model {
+	uint32_t programContextId = 0; // index-1 into array in renderer
+	uint32_t meshContextId = 0; // index-1 into array in renderer
+
+	GLuint textureBufferId = 0; // opengl id
+
+	std::string meshName = "";
+};
+
+// stored in archetypes, so the renderer walks transforms and models together
+template <>
+struct ComponentPool<Model> {
+	using type = ArchetypePool<Model>;
+};
+
+// contexts and buffers are the renderer's, so a snapshot with models only makes sense reloaded while it still has them
+template <>
+struct ComponentSnapshot<Model> {
+	static constexpr bool saved = true;
+
+	static void save(const Model& model, std::vector<uint8_t>* bytes);
+	static bool load(SystemInterface::Engine& engine, uint64_t id, const uint8_t* bytes, size_t size);
+};
+
+inline void ComponentSnapshot<Model>::save(const Model& model, std::vector<uint8_t>* bytes) {
+	const uint32_t ids[] = { model.programContextId, model.meshContextId, model.textureBufferId };
+	const uint8_t* begin = reinterpret_cast<const uint8_t*>(ids);
+
+	// mesh name fills the rest
+	bytes->insert(bytes->end(), begin, begin + sizeof(ids));
+	bytes->insert(bytes->end(), model.meshName.begin(), model.meshName.end());
+}
+
+inline bool ComponentSnapshot<Model>::load(SystemInterface::Engine& engine, uint64_t id, const uint8_t* bytes, size_t size) {
+	uint32_t ids[3];
+
+	if (size < sizeof(ids))
+		return false;
+
+	memcpy(ids, bytes, sizeof(ids));
+
+	Model& model = *engine.addComponent<Model>(id);
+
+	model.programContextId = ids[0];
+	model.meshContextId = ids[1];
+	model.textureBufferId = ids[2];
+	model.meshName.assign(reinterpret_cast<const char*>(bytes) + sizeof(ids), size - sizeof(ids));
+
+	return true;
+}
\ No newline at end of file
@@ -0,0 +1,121 @@
+#include "Prefab.hpp"
+
+#include "Transform.hpp"
+
+uint32_t Prefab::addNode(uint32_t parent) {
+	// only the root has no parent
+	assert((parent == none) == _nodes.empty());
+	assert(parent == none || parent < _nodes.size());
+
+	uint32_t index = static_cast<uint32_t>(_nodes.size());
+	_nodes.emplace_back();
+
+	_nodes[index].parent = parent;
+
+	return index;
+}
+
+Prefab::Node& Prefab::node(uint32_t index) {
+	assert(index < _nodes.size());
+	return _nodes[index];
+}
+
+const Prefab::Node& Prefab::node(uint32_t index) const {
+	assert(index < _nodes.size());
+	return _nodes[index];
+}
+
+uint32_t Prefab::size() const {
+	return static_cast<uint32_t>(_nodes.size());
+}
+
+void Prefab::record(const SystemInterface::Engine& engine, uint64_t root) {
+	_nodes.clear();
+
+	// breadth first, so parents are added before children
+	std::vector<std::pair<uint32_t, uint64_t>> queue = { { none, root } }; // parent node and id
+	std::vector<uint64_t> children;
+
+	for (size_t i = 0; i < queue.size(); i++) {
+		uint32_t index = addNode(queue[i].first);
+		Node& node = _nodes[index];
+
+		const Transform* transform = engine.getComponent<Transform>(queue[i].second);
+		const Model* model = engine.getComponent<Model>(queue[i].second);
+
+		if (model) {
+			node.hasModel = true;
+			node.model = *model;
+		}
+
+		if (!transform)
+			continue;
+
+		node.position = transform->position();
+		node.rotation = transform->rotation();
+		node.scale = transform->scale();
+
+		if (!transform->hasChildren())
+			continue;
+
+		transform->getChildren(&children);
+
+		for (uint64_t child : children)
+			queue.push_back({ index, child });
+	}
+}
+
+void Prefab::instantiate(SystemInterface::Engine& engine, const uint64_t* roots, uint32_t count) const {
+	// adds during iteration are deferred, so the components set up below wouldn't exist yet
+	assert(!engine.iterating() && "instantiate outside of each");
+
+	if (_nodes.empty() || !count)
+		return;
+
+	const uint32_t size = static_cast<uint32_t>(_nodes.size());
+
+	// each copy's ids in node order, roots are given and the rest created at once
+	std::vector<uint64_t> ids(size * count);
+	std::vector<uint64_t> created((size - 1) * count);
+
+	engine.createEntities(static_cast<uint32_t>(created.size()), created.data());
+
+	for (uint32_t i = 0; i < count; i++) {
+		ids[i * size] = roots[i];
+		std::copy(created.begin() + i * (size - 1), created.begin() + (i + 1) * (size - 1), ids.begin() + i * size + 1);
+	}
+
+	// roots which already have a transform keep it
+	engine.addComponents<Transform>(ids.data(), static_cast<uint32_t>(ids.size()));
+
+	std::vector<uint64_t> modelIds;
+
+	for (uint32_t i = 0; i < ids.size(); i++) {
+		if (_nodes[i % size].hasModel)
+			modelIds.push_back(ids[i]);
+	}
+
+	engine.addComponents<Model>(modelIds.data(), static_cast<uint32_t>(modelIds.size()));
+
+	TransformSystem& transforms = engine.system<TransformSystem>();
+
+	for (uint32_t i = 0; i < count; i++) {
+		const uint64_t* copy = ids.data() + i * size;
+
+		for (uint32_t j = 0; j < size; j++) {
+			const Node& node = _nodes[j];
+
+			if (node.hasModel)
+				*engine.getComponent<Model>(copy[j]) = node.model;
+
+			if (j == 0)
+				continue;
+
+			// parents come before children in node order, sibling order isn't kept
+			transforms.setPosition(copy[j], node.position);
+			transforms.setRotation(copy[j], node.rotation);
+			transforms.setScale(copy[j], node.scale);
+			transforms.setParent(copy[j], copy[node.parent]);
+		}
+	}
+}
\ No newline at end of file
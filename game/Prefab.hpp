@@ -0,0 +1,46 @@
+#pragma once
+
+#include "SystemInterface.hpp"
+
+#include "Model.hpp"
+
+#include <glm\vec3.hpp>
+#include <glm\gtc\quaternion.hpp>
+
+#include <vector>
+
+// hierarchy of transforms and models recorded once, node 0 is the root, which instantiating maps onto an existing entity
+class Prefab {
+public:
+	static constexpr uint32_t none = UINT32_MAX;
+
+	struct Node {
+		uint32_t parent = none; // node index, none for the root
+
+		glm::vec3 position;
+		glm::quat rotation;
+		glm::vec3 scale = { 1, 1, 1 };
+
+		bool hasModel = false;
+		Model model;
+	};
+
+private:
+	std::vector<Node> _nodes; // parents before children
+
+public:
+	// adds a node under parent, returning its index
+	uint32_t addNode(uint32_t parent = none);
+
+	Node& node(uint32_t index);
+
+	const Node& node(uint32_t index) const;
+
+	uint32_t size() const;
+
+	// records root's hierarchy of transforms and models from the engine
+	void record(const SystemInterface::Engine& engine, uint64_t root);
+
+	// a copy onto each of count roots, which keep their own transform, not inside each as adds would be deferred
+	void instantiate(SystemInterface::Engine& engine, const uint64_t* roots, uint32_t count) const;
+};
\ No newline at end of file
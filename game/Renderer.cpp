@@ -14,6 +14,7 @@
 #include <stb_truetype.h>
 
 #include "Transform.hpp"
+#include "TransformKernels.hpp"
 
 
 inline void errorCallback(GLenum source, GLenum type, GLuint id, GLenum severity, GLsizei length, const GLchar* message, const void* userParam) {
@@ -29,22 +30,32 @@ void Renderer::_reshape(){
 }
 
 Model* Renderer::_addModel(uint64_t id, uint32_t mesh, uint32_t texture, GLuint program) {
-	Model& model = *_engine.addComponent<Model>(id);
+	// a new model is set up first then added with its values, as during iteration the add is only done once it's over
+	Model added;
+	Model* model = _engine.getComponent<Model>(id);
+
+	if (!model)
+		model = &added;
 
 	if (mesh)
-		model.meshContextId = mesh;
+		model->meshContextId = mesh;
 
 	if (program)
-		model.programContextId = program;
-	else if (!model.programContextId && _defaultProgram)
-		model.programContextId = _defaultProgram;
+		model->programContextId = program;
+	else if (!model->programContextId && _defaultProgram)
+		model->programContextId = _defaultProgram;
 
 	if (texture)
-		model.textureBufferId = texture;
-	else if (!model.textureBufferId && _defaultTexture)
-		model.textureBufferId = _defaultTexture;
+		model->textureBufferId = texture;
+	else if (!model->textureBufferId && _defaultTexture)
+		model->textureBufferId = _defaultTexture;
+
+	if (model == &added)
+		return _engine.addComponent<Model>(id, std::move(added));
+
+	_engine.markChanged<Model>(id);
 
-	return &model;
+	return model;
 }
 
 bool Renderer::_compileShader(GLuint type, GLuint* shader, const std::string & file){
@@ -58,7 +69,7 @@ bool Renderer::_compileShader(GLuint type, GLuint* shader, const std::string & f
 	if (!stream.is_open())
 		return false;
 
-	const std::string source = std::string(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>());
+	const FrameString source(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>(), _engine.frameArena());
 
 	stream.close();
 
@@ -76,7 +87,7 @@ bool Renderer::_compileShader(GLuint type, GLuint* shader, const std::string & f
 	GLint length = 0;
 	glGetShaderiv(*shader, GL_INFO_LOG_LENGTH, &length);
 
-	std::vector<GLchar> message(length);
+	FrameVector<GLchar> message(length, _engine.frameArena());
 	glGetShaderInfoLog(*shader, length, &length, &message[0]);
 
 	glDeleteShader(*shader);
@@ -142,33 +153,31 @@ void Renderer::_bufferMesh(MeshContext* meshContext, const aiMesh& mesh){
 	}
 }
 
-void Renderer::_recusriveBufferMesh(const aiScene& scene, const aiNode& node, uint64_t parent, std::vector<uint32_t>* meshContextIds){
-	assert(meshContextIds); // sanity
+void Renderer::_recusriveBufferMesh(const aiScene& scene, const aiNode& node, uint32_t parent, Prefab* prefab, std::vector<uint32_t>* meshContextIds){
+	assert(prefab && meshContextIds); // sanity
 
-	// if root then set id to parent, else create new one
-	uint64_t id;
+	// if root then it's the prefab's root, else add a node with the node's transform
+	uint32_t index;
 
 	if (scene.mRootNode == &node) {
 		meshContextIds->resize(scene.mNumMeshes);
 		std::fill(meshContextIds->begin(), meshContextIds->end(), 0);
 
-		id = parent;
+		index = prefab->addNode();
 	}
-	else if (parent) {
-		id = _engine.createEntity();
-
-		Transform& transform = *_engine.addComponent<Transform>(id);
+	else {
+		index = prefab->addNode(parent);
 
-		_engine.addComponent<Transform>(parent)->addChild(id);
+		Prefab::Node& prefabNode = prefab->node(index);
 
 		aiVector3D position, scale;
 		aiQuaternion rotation;
 
 		node.mTransformation.Decompose(scale, rotation, position);
 
-		fromAssimp(position, &transform.position);
-		fromAssimp(scale, &transform.scale);
-		fromAssimp(rotation, &transform.rotation);
+		fromAssimp(position, &prefabNode.position);
+		fromAssimp(scale, &prefabNode.scale);
+		fromAssimp(rotation, &prefabNode.rotation);
 	}
 
 	// buffer mesh if existing
@@ -184,20 +193,24 @@ void Renderer::_recusriveBufferMesh(const aiScene& scene, const aiNode& node, ui
 			_bufferMesh(&_meshContexts[meshContextId - 1], *scene.mMeshes[node.mMeshes[0]]);
 		}
 
-		if (parent) {
-			Model* model = _addModel(id, meshContextId);
-			model->meshName = node.mName.C_Str();
-		}
+		Prefab::Node& prefabNode = prefab->node(index);
+
+		prefabNode.hasModel = true;
+		prefabNode.model.meshContextId = meshContextId;
+		prefabNode.model.programContextId = _defaultProgram;
+		prefabNode.model.textureBufferId = _defaultTexture;
+		prefabNode.model.meshName = node.mName.C_Str();
 	}
 
 	// recurse
 	for (uint32_t i = 0; i < node.mNumChildren; i++)
-		_recusriveBufferMesh(scene, *node.mChildren[i], id, meshContextIds);
+		_recusriveBufferMesh(scene, *node.mChildren[i], index, prefab, meshContextIds);
 }
 
-Renderer::Renderer(Engine& engine, const ConstructorInfo& constructionInfo) : _engine(engine), _constructionInfo(constructionInfo), _camera(engine){
+Renderer::Renderer(Engine& engine, const ConstructorInfo& constructionInfo) : _engine(engine), _models(engine.query<const Transform, const Model>()), _constructionInfo(constructionInfo), _camera(engine){
 	SYSFUNC_ENABLE(SystemInterface, initiate, 0);
-	SYSFUNC_ENABLE(SystemInterface, update, 1);
+	// after the transform pass, on the thread with the gl context
+	SYSFUNC_ENABLE(SystemInterface, update, 2).reads<Transform, Model>().mainThread();
 
 	SYSFUNC_ENABLE(SystemInterface, framebufferSize, 0);
 	SYSFUNC_ENABLE(SystemInterface, windowOpen, 0);
@@ -237,13 +250,14 @@ void Renderer::update(double dt){
 
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-	_engine.iterateEntities([&](Engine::Entity& entity) {
-		if (!entity.has<Transform, Model>())
-			return;
+	// same for every model
+	const glm::mat4 viewMatrix = Renderer::viewMatrix();
 
-		const Transform& transform = *entity.get<Transform>();
-		Model& model = *entity.get<Model>();
+	// gathered first, so model view matrices are made together
+	FrameVector<const Model*> models(_engine.frameArena());
+	FrameVector<glm::mat4> modelMatrices(_engine.frameArena());
 
+	_models.each([&](uint64_t id, const Transform& transform, const Model& model) {
 		if (!model.meshContextId)
 			return;
 
@@ -273,6 +287,17 @@ void Renderer::update(double dt){
 		if (!model.programContextId || !model.textureBufferId)
 			return;
 
+		models.push_back(&model);
+		modelMatrices.push_back(transform.globalMatrix());
+	});
+
+	const uint32_t count = static_cast<uint32_t>(models.size());
+
+	FrameVector<glm::mat4> modelViewMatrices(count, _engine.frameArena());
+	multiplyMatrices(viewMatrix, modelMatrices.data(), modelViewMatrices.data(), count);
+
+	for (uint32_t i = 0; i < count; i++) {
+		const Model& model = *models[i];
 		const ProgramContext& program = _programContexts[model.programContextId - 1];
 
 		glUseProgram(program.program);
@@ -282,24 +307,16 @@ void Renderer::update(double dt){
 			glUniformMatrix4fv(program.projectionUnifLoc, 1, GL_FALSE, &_projectionMatrix[0][0]);
 
 		// view matrix
-		glm::dmat4 viewMatrix = Renderer::viewMatrix();
-
 		if (program.viewUnifLoc != -1)
-			glUniformMatrix4fv(program.viewUnifLoc, 1, GL_FALSE, &((glm::mat4)viewMatrix)[0][0]);
+			glUniformMatrix4fv(program.viewUnifLoc, 1, GL_FALSE, &viewMatrix[0][0]);
 
 		// model matrix
-		glm::dmat4 modelMatrix;
-
-		if (program.modelViewUnifLoc != -1 || program.viewUnifLoc != -1) {
-			modelMatrix = transform.globalMatrix();
-
-			if (program.viewUnifLoc != -1)
-				glUniformMatrix4fv(program.modelUnifLoc, 1, GL_FALSE, &((glm::mat4)modelMatrix)[0][0]);
-		}
+		if (program.modelUnifLoc != -1)
+			glUniformMatrix4fv(program.modelUnifLoc, 1, GL_FALSE, &modelMatrices[i][0][0]);
 
 		// model view matrix
 		if (program.modelViewUnifLoc != -1)
-			glUniformMatrix4fv(program.modelViewUnifLoc, 1, GL_FALSE, &((glm::mat4)(viewMatrix * modelMatrix))[0][0]);
+			glUniformMatrix4fv(program.modelViewUnifLoc, 1, GL_FALSE, &modelViewMatrices[i][0][0]);
 
 		// texture
 		if (program.textureUnifLoc != -1) {
@@ -317,7 +334,7 @@ void Renderer::update(double dt){
 		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, meshContext.indexBuffer);
 
 		glDrawElements(GL_TRIANGLES, meshContext.indexCount, GL_UNSIGNED_INT, 0);
-	});
+	}
 }
 
 void Renderer::reshape(const ShapeInfo& config){
@@ -407,10 +424,8 @@ uint32_t Renderer::loadProgram(const std::string& vertexFile, const std::string&
 		program.textureUnifLoc = glGetUniformLocation(program.program, _constructionInfo.textureUnifName.c_str());
 	}
 	
-	if (_engine.validEntity(id)) {
-		Model& model = *_engine.addComponent<Model>(id);
-		model.programContextId = programIndex + 1;
-	}
+	if (_engine.validEntity(id))
+		_addModel(id, 0, 0, programIndex + 1);
 
 	return programIndex + 1;
 }
@@ -458,18 +473,12 @@ GLuint Renderer::loadTexture(const std::string & textureFile, uint64_t id, bool
 	return textureBuffer;
 }
 
-uint32_t Renderer::loadMesh(const std::string& meshFile, uint64_t id, bool reload){
-	// if not reloading, and mesh already loaded, set model to existing or ignore if no id
-	//auto iter = _meshFiles.find(meshFile);
-	//
-	//if (!reload && iter != _meshFiles.end()) {
-	//	uint32_t index = iter->second + 1;
-	//
-	//	if (id)
-	//		_addModel(id, index);
-	//
-	//	return index;
-	//}
+const Prefab* Renderer::loadPrefab(const std::string& meshFile, bool reload){
+	// if not reloading, and mesh already loaded, return its hierarchy
+	auto iter = _meshFiles.find(meshFile);
+
+	if (!reload && iter != _meshFiles.end())
+		return &iter->second.first;
 
 	// mesh not found or reloading, therefore load mesh from file
 	Assimp::Importer importer;
@@ -477,34 +486,32 @@ uint32_t Renderer::loadMesh(const std::string& meshFile, uint64_t id, bool reloa
 	const aiScene* scene = importer.ReadFile(meshFile, aiProcessPreset_TargetRealtime_MaxQuality);
 
 	if (!scene || !scene->mNumMeshes)
-		return 0;
+		return nullptr;
 
+	Prefab prefab;
 	std::vector<uint32_t> meshContextIds;
 
-	_recusriveBufferMesh(*scene, *scene->mRootNode, id, &meshContextIds);
-
-	return meshContextIds[0];
-
-	// buffer mesh
-	//MeshContext* meshContext;
-	//uint32_t meshIndex;
-	//
-	//if (iter == _meshFiles.end()) {
-	//	meshIndex = _meshContexts.size();
-	//	_meshContexts.resize(_meshContexts.size() + 1);
-	//	meshContext = &*_meshContexts.rbegin();
-	//}
-	//else {
-	//	meshIndex = iter->second;
-	//	meshContext = &_meshContexts[iter->second];
-	//}
-	//
-	//_bufferMesh(meshContext, *scene->mMeshes[0]);
-	//
-	//if (id)
-	//	_addModel(id, meshIndex + 1);
-	//
-	//return meshIndex + 1;
+	_recusriveBufferMesh(*scene, *scene->mRootNode, Prefab::none, &prefab, &meshContextIds);
+
+	std::pair<Prefab, uint32_t>& meshFileData = _meshFiles[meshFile];
+
+	meshFileData.first = std::move(prefab);
+	meshFileData.second = meshContextIds[0];
+
+	return &meshFileData.first;
+}
+
+uint32_t Renderer::loadMesh(const std::string& meshFile, uint64_t id, bool reload){
+	const Prefab* prefab = loadPrefab(meshFile, reload);
+
+	if (!prefab)
+		return 0;
+
+	// copies the hierarchy onto id, rather than importing again
+	if (id)
+		prefab->instantiate(_engine, &id, 1);
+
+	return _meshFiles[meshFile].second;
 }
 
 void Renderer::defaultProgram(const std::string& vertexFile, const std::string& fragmentFile){
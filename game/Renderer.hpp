@@ -3,6 +3,8 @@
 #include "SystemInterface.hpp"
 
 #include "Window.hpp"
+#include "Model.hpp"
+#include "Prefab.hpp"
 
 #include <glm\vec3.hpp>
 #include <glm\gtc\quaternion.hpp>
@@ -32,16 +34,6 @@ inline void fromAssimp(const aiQuaternion& const from, glm::quat* to) {
 	to->z = from.z;
 }
 
-
-struct Model {
-	uint32_t programContextId = 0; // index-1 into array in renderer
-	uint32_t meshContextId = 0; // index-1 into array in renderer
-
-	GLuint textureBufferId = 0; // opengl id
-
-	std::string meshName = "";
-};
-
 class Renderer : public SystemInterface {
 private:
 	struct ProgramContext {
@@ -89,6 +81,8 @@ public:
 private:
 	Engine& _engine;
 
+	Engine::Query<const Transform, const Model> _models; // cached, so update only visits entities with models
+
 	const ConstructorInfo _constructionInfo;
 
 	bool _rendering = false;
@@ -102,7 +96,7 @@ private:
 	std::vector<MeshContext> _meshContexts;
 
 	std::unordered_map<std::string, GLuint> _textureFiles;
-	//std::unordered_map<std::string, uint32_t> _meshFiles;
+	std::unordered_map<std::string, std::pair<Prefab, uint32_t>> _meshFiles; // hierarchy and first mesh context id
 	std::unordered_map<std::string, GLuint> _shaderFiles;
 	std::unordered_map<std::string, uint32_t> _programFiles;
 
@@ -111,13 +105,14 @@ private:
 	
 	void _reshape();
 
+	// null if added during iteration, as it's only added once that's over
 	Model* _addModel(uint64_t id, uint32_t mesh = 0, uint32_t texture = 0, GLuint program = 0);
 
 	bool _compileShader(GLuint type, GLuint* shader, const std::string & file);
 
 	void _bufferMesh(MeshContext* meshContext, const aiMesh& mesh);
 
-	void _recusriveBufferMesh(const aiScene& scene, const aiNode& node, uint64_t parent, std::vector<uint32_t>* meshContextIds);
+	void _recusriveBufferMesh(const aiScene& scene, const aiNode& node, uint32_t parent, Prefab* prefab, std::vector<uint32_t>* meshContextIds);
 
 public:
 	Renderer(Engine& engine, const ConstructorInfo& constructionInfo = ConstructorInfo());
@@ -134,6 +129,9 @@ public:
 	GLuint loadTexture(const std::string& textureFile, uint64_t id = 0, bool reload = false);
 	uint32_t loadMesh(const std::string& meshFile, uint64_t id = 0, bool reload = false);
 
+	// mesh file's hierarchy, imported once, instantiate it to make copies
+	const Prefab* loadPrefab(const std::string& meshFile, bool reload = false);
+
 	void defaultProgram(const std::string& vertexFile, const std::string& fragmentFile);
 	void defaultTexture(const std::string& textureFile);
 
@@ -5,7 +5,15 @@
 #include <glm\glm.hpp>
 #include <vector>
 
-class SystemInterface : public SimpleEngine<SystemInterface, 32>::BaseSystem {
+class Transform;
+struct Model;
+
+class Window;
+class Controller;
+class Renderer;
+class TransformSystem;
+
+class SystemInterface : public SimpleEngine<SystemInterface, 32, Components<Transform, Model>, Systems<Window, Controller, Renderer, TransformSystem>>::BaseSystem {
 public:
 	enum Modifier : uint8_t {
 		Mod_None = 0,
@@ -1,6 +1,13 @@
 #include "Transform.hpp"
 
-#include <glm\gtc\matrix_transform.hpp>
+#include <cstring>
+
+struct SavedTransform {
+	glm::vec3 position;
+	glm::quat rotation;
+	glm::vec3 scale;
+	uint64_t parent;
+};
 
 const glm::vec3 Transform::globalUp(0, 0, 1);
 const glm::vec3 Transform::globalDown(0, 0, -1);
@@ -16,183 +23,133 @@ const glm::vec3 Transform::localRight(1, 0, 0);
 const glm::vec3 Transform::localForward(0, 0, -1);
 const glm::vec3 Transform::localBack(0, 0, 1);
 
-Transform::Transform(SystemInterface::Engine& engine, uint64_t id) : _engine(engine), _id(id) { }
-
-Transform::~Transform() {
-	removeParent();
-	removeChildren();
+Transform::Transform(SystemInterface::Engine& engine, uint64_t id) : _engine(engine), _id(id) {
+	_system().add(_id);
 }
 
-void Transform::addChild(uint64_t childId) {
-	Transform* newChild = _engine.getComponent<Transform>(childId);
-
-	// if no transform, or already a child of this
-	if (!newChild || newChild->_parent == _id)
-		return;
-
-	// if child of something else
-	if (newChild->_parent)
-		newChild->removeParent();
-
-	// set parent
-	newChild->_parent = _id;
-
-	// if first child
-	if (!_firstChild) {
-		newChild->_leftSibling = childId;
-		newChild->_rightSibling = childId;
-		_firstChild = childId;
-
-		return;
-	}
-
-	Transform* firstChild = _engine.getComponent<Transform>(_firstChild);
-	Transform* secondChild;
+Transform::Transform(Transform&& other) : _engine(other._engine), _id(other._id) {
+	// everything is in the system by id, so only the id moves
+	other._id = 0;
+}
 
-	// if only one sibling
-	if (firstChild->_rightSibling == _firstChild)
-		secondChild = firstChild;
-	else
-		secondChild = _engine.getComponent<Transform>(firstChild->_rightSibling);
+Transform::~Transform() {
+	if (_id)
+		_system().remove(_id);
+}
 
-	// add into linked list after first child   O O O O --> O X O O O
-	newChild->_leftSibling = _firstChild;
-	newChild->_rightSibling = firstChild->_rightSibling;
+TransformSystem& Transform::_system() const {
+	return _engine.system<TransformSystem>();
+}
 
-	firstChild->_rightSibling = childId;
-	secondChild->_leftSibling = childId;
+void Transform::addChild(uint64_t id) {
+	_system().setParent(id, _id);
 }
 
 void Transform::removeParent() {
-	if (!_parent)
-		return;
-
-	Transform* parent = _engine.getComponent<Transform>(_parent);
-
-	// if only child
-	if (_rightSibling == _id) {
-		parent->_firstChild = 0;
-		_rightSibling = _id;
-		_leftSibling = _id;
-	}
-	else {
-		// set parent
-		if (parent->_firstChild == _id)
-			parent->_firstChild = _rightSibling;
-
-		Transform* leftSibling = _engine.getComponent<Transform>(_leftSibling);
-		Transform* rightSibling;
-
-		// if only one sibling
-		if (_leftSibling == _rightSibling)
-			rightSibling = leftSibling;
-		else
-			rightSibling = _engine.getComponent<Transform>(_rightSibling);
-
-		// remove from linked list
-		leftSibling->_rightSibling = _rightSibling;
-		rightSibling->_leftSibling = _leftSibling;
-	}
-
-	_parent = 0;
-	_rightSibling = _id;
-	_leftSibling = _id;
+	_system().setParent(_id, 0);
 }
 
 void Transform::removeChildren() {
-	if (!_firstChild)
-		return;
-
-	uint64_t i = _rightSibling;
-
-	while (i != _id) {
-		Transform* sibling = _engine.getComponent<Transform>(_rightSibling);
-
-		i = sibling->_rightSibling;
-
-		sibling->_parent = 0;
-		sibling->_leftSibling = sibling->_id;
-		sibling->_rightSibling = sibling->_id;
-	}
-
-	_firstChild = 0;
+	_system().removeChildren(_id);
 }
 
-void Transform::_getChildren(uint64_t id, uint32_t count, std::vector<uint64_t>* ids) const {
-	Transform* sibling = _engine.getComponent<Transform>(id);
-
-	if (sibling->_rightSibling == _firstChild)
-		ids->resize(count + 1);
-	else
-		_getChildren(sibling->_rightSibling, count + 1, ids);
-
-	ids->at(count) = sibling->_id;
+uint64_t Transform::parent() const {
+	return _system().parent(_id);
 }
 
 bool Transform::hasChildren() const {
-	return _firstChild;
+	return _system().childCount(_id);
 }
 
-void Transform::getChildren(std::vector<uint64_t>* ids) const {
-	if (!_firstChild)
-		return;
-
-	_getChildren(_firstChild, 0, ids);
+glm::vec3 Transform::position() const {
+	return _system().position(_id);
 }
 
-glm::mat4 Transform::globalMatrix() const {
-	glm::vec3 globalPosition = position;
-	glm::quat globalRotation = rotation;
-	glm::vec3 globalScale = scale;
+glm::quat Transform::rotation() const {
+	return _system().rotation(_id);
+}
 
-	const Transform* parent = _engine.getComponent<Transform>(_parent);
+glm::vec3 Transform::scale() const {
+	return _system().scale(_id);
+}
 
-	while (parent != nullptr) {
-		globalPosition = (parent->position + parent->rotation * globalPosition);// *parent->scale;
-		globalRotation = parent->rotation * globalRotation;
-		globalScale *= parent->scale;
+void Transform::setPosition(const glm::vec3& position) {
+	_system().setPosition(_id, position);
+}
 
-		parent = _engine.getComponent<Transform>(parent->_parent);
-	}
+void Transform::setRotation(const glm::quat& rotation) {
+	_system().setRotation(_id, rotation);
+}
 
-	glm::mat4 matrix;
+void Transform::setScale(const glm::vec3& scale) {
+	_system().setScale(_id, scale);
+}
 
-	matrix = glm::translate(matrix, globalPosition);
-	matrix *= glm::mat4_cast(globalRotation);
-	matrix = glm::scale(matrix, globalScale);
+const glm::mat4& Transform::globalMatrix() const {
+	return _system().globalMatrix(_id);
+}
 
-	return matrix;
+const glm::mat4& Transform::updateGlobalMatrix() {
+	return _system().updateGlobalMatrix(_id);
 }
 
 void Transform::localRotate(const glm::quat& rotate) {
-	rotation = rotation * rotate;
+	setRotation(rotation() * rotate);
 }
 
 void Transform::localTranslate(const glm::vec3& translation) {
-	position = position + rotation * translation;
+	setPosition(position() + rotation() * translation);
 }
 
 void Transform::localScale(const glm::vec3 & scaling) {
-	scale = scale * scaling;
+	setScale(scale() * scaling);
 }
 
 void Transform::globalRotate(const glm::quat& rotate) {
 	//if (!parent)
-		rotation = rotate * rotation;
+		setRotation(rotate * rotation());
 	//else
 	//	_setRotation(glm::inverse(parent->worldRotation()) * (rotation * worldRotation()));
 }
 
 void Transform::globalTranslate(const glm::vec3& translation) {
 	//if (!parent)
-		position = position + translation;
+		setPosition(position() + translation);
 	//else
 	//	_setPosition(_position + glm::inverse(parent->worldRotation()) * translation);
 }
 
 void Transform::globalScale(const glm::vec3 & scaling) {
 	//if (!parent)
-		scale = scale * scaling;
+		setScale(scale() * scaling);
 	//else
 	//	_setScale(scaling / parent->worldScale());
+}
+
+void ComponentSnapshot<Transform>::save(const Transform& transform, std::vector<uint8_t>* bytes) {
+	const SavedTransform saved = { transform.position(), transform.rotation(), transform.scale(), transform.parent() };
+	const uint8_t* begin = reinterpret_cast<const uint8_t*>(&saved);
+
+	bytes->insert(bytes->end(), begin, begin + sizeof(SavedTransform));
+}
+
+bool ComponentSnapshot<Transform>::load(SystemInterface::Engine& engine, uint64_t id, const uint8_t* bytes, size_t size) {
+	if (size != sizeof(SavedTransform))
+		return false;
+
+	SavedTransform saved;
+	memcpy(&saved, bytes, sizeof(SavedTransform));
+
+	// already there if it's the parent of one loaded before
+	Transform& transform = *engine.addComponent<Transform>(id);
+
+	transform.setPosition(saved.position);
+	transform.setRotation(saved.rotation);
+	transform.setScale(saved.scale);
+
+	// adding the parent's may move this one, so it's done last
+	if (saved.parent && engine.validEntity(saved.parent))
+		engine.addComponent<Transform>(saved.parent)->addChild(id);
+
+	return true;
 }
\ No newline at end of file
@@ -1,21 +1,18 @@
 #pragma once
 
 #include "SystemInterface.hpp"
+#include "TransformSystem.hpp"
 
 #include <glm\vec3.hpp>
 #include <glm\gtc\quaternion.hpp>
 #include <glm\mat4x4.hpp>
 
+// Handle onto the entity's place in the TransformSystem, which keeps the hierarchy and transforms in flat arrays.
 class Transform{
 	SystemInterface::Engine& _engine;
-	const uint64_t _id;
+	uint64_t _id; // 0 once moved from, so its destructor doesn't remove this from the hierarchy
 
-	uint64_t _parent = 0;
-
-	uint64_t _firstChild = 0;
-
-	uint64_t _leftSibling = _id;
-	uint64_t _rightSibling = _id;
+	TransformSystem& _system() const;
 
 public:
 	static const glm::vec3 localUp;
@@ -32,25 +29,34 @@ public:
 	static const glm::vec3 globalForward;
 	static const glm::vec3 globalBack;
 
-	glm::vec3 position;
-	glm::quat rotation;
-	glm::vec3 scale = { 1, 1, 1 };
-
-private:
-	void _getChildren(uint64_t id, uint32_t count, std::vector<uint64_t>* ids) const;
-
-public:
 	Transform(SystemInterface::Engine& engine, uint64_t id);
+	Transform(Transform&& other);
 	~Transform();
 
 	void addChild(uint64_t id);
 	void removeParent();
 	void removeChildren();
 
+	uint64_t parent() const;
 	bool hasChildren() const;
-	void getChildren(std::vector<uint64_t>* ids) const;
 
-	glm::mat4 globalMatrix() const;
+	// takes any allocator, so a FrameVector can be used in per frame code
+	template <typename Allocator>
+	void getChildren(std::vector<uint64_t, Allocator>* ids) const;
+
+	glm::vec3 position() const;
+	glm::quat rotation() const;
+	glm::vec3 scale() const;
+
+	void setPosition(const glm::vec3& position);
+	void setRotation(const glm::quat& rotation);
+	void setScale(const glm::vec3& scale);
+
+	// as of the last transform pass, valid until the hierarchy changes
+	const glm::mat4& globalMatrix() const;
+
+	// up to date even between passes, so writes to the transform system
+	const glm::mat4& updateGlobalMatrix();
 
 	void localRotate(const glm::quat& rotation);
 	void localTranslate(const glm::vec3& translation);
@@ -59,4 +65,24 @@ public:
 	void globalRotate(const glm::quat& rotation);
 	void globalTranslate(const glm::vec3& translation);
 	void globalScale(const glm::vec3 & scaling);
+};
+
+template <typename Allocator>
+void Transform::getChildren(std::vector<uint64_t, Allocator>* ids) const {
+	_system().children(_id, ids);
+}
+
+// stored in archetypes, so transforms and models of rendered entities are iterated together
+template <>
+struct ComponentPool<Transform> {
+	using type = ArchetypePool<Transform>;
+};
+
+// saved as the local transform and parent, a parent not loaded yet is given its transform early
+template <>
+struct ComponentSnapshot<Transform> {
+	static constexpr bool saved = true;
+
+	static void save(const Transform& transform, std::vector<uint8_t>* bytes);
+	static bool load(SystemInterface::Engine& engine, uint64_t id, const uint8_t* bytes, size_t size);
 };
\ No newline at end of file
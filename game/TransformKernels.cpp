@@ -0,0 +1,327 @@
+#include "TransformKernels.hpp"
+
+#include <glm\gtc\matrix_transform.hpp>
+
+#include <cstring>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define KERNELS_X86
+#endif
+
+#ifdef KERNELS_X86
+#include <immintrin.h>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#define KERNELS_AVX // msvc compiles avx intrinsics without flags
+#else
+#define KERNELS_AVX __attribute__((target("avx")))
+#endif
+#endif
+
+// widest last, each supported wherever the next one is
+enum class KernelSet {
+	Scalar,
+	Sse,
+	Avx,
+};
+
+static KernelSet kernelSet() {
+#ifdef KERNELS_X86
+#ifdef _MSC_VER
+	int info[4];
+	__cpuid(info, 1);
+
+	// avx needs the os to save its registers too
+	bool osxsave = info[2] & (1 << 27);
+	bool avx = info[2] & (1 << 28);
+
+	if (osxsave && avx && (_xgetbv(0) & 6) == 6)
+		return KernelSet::Avx;
+#else
+	if (__builtin_cpu_supports("avx"))
+		return KernelSet::Avx;
+#endif
+
+	return KernelSet::Sse;
+#else
+	return KernelSet::Scalar;
+#endif
+}
+
+// picked once, unless changed by useTransformKernels
+static KernelSet& selectedSet() {
+	static KernelSet set = kernelSet();
+	return set;
+}
+
+static void transformMatricesScalar(const glm::vec3* positions, const glm::quat* rotations, const glm::vec3* scales, glm::mat4* matrices, uint32_t count) {
+	for (uint32_t i = 0; i < count; i++) {
+		glm::mat4& matrix = matrices[i];
+
+		matrix = glm::mat4();
+		matrix = glm::translate(matrix, positions[i]);
+		matrix *= glm::mat4_cast(rotations[i]);
+		matrix = glm::scale(matrix, scales[i]);
+	}
+}
+
+static void multiplyMatricesScalar(const glm::mat4& left, const glm::mat4* rights, glm::mat4* results, uint32_t count) {
+	for (uint32_t i = 0; i < count; i++)
+		results[i] = left * rights[i];
+}
+
+#ifdef KERNELS_X86
+// transposes registers holding a component of four matrices' column, and stores it into each of them
+static inline void storeColumn(__m128 x, __m128 y, __m128 z, __m128 w, glm::mat4* matrices, uint32_t column) {
+	_MM_TRANSPOSE4_PS(x, y, z, w);
+
+	_mm_storeu_ps(&matrices[0][column][0], x);
+	_mm_storeu_ps(&matrices[1][column][0], y);
+	_mm_storeu_ps(&matrices[2][column][0], z);
+	_mm_storeu_ps(&matrices[3][column][0], w);
+}
+
+// four transforms at a time, a lane each, worked out a component per register then transposed into columns
+static void transformMatricesSse(const glm::vec3* positions, const glm::quat* rotations, const glm::vec3* scales, glm::mat4* matrices, uint32_t count) {
+	const __m128 one = _mm_set1_ps(1.f);
+	const __m128 zero = _mm_setzero_ps();
+
+	uint32_t i = 0;
+
+	for (; i + 4 <= count; i += 4) {
+		const glm::quat* q = rotations + i;
+		const glm::vec3* s = scales + i;
+		const glm::vec3* p = positions + i;
+
+		__m128 x = _mm_set_ps(q[3].x, q[2].x, q[1].x, q[0].x);
+		__m128 y = _mm_set_ps(q[3].y, q[2].y, q[1].y, q[0].y);
+		__m128 z = _mm_set_ps(q[3].z, q[2].z, q[1].z, q[0].z);
+		__m128 w = _mm_set_ps(q[3].w, q[2].w, q[1].w, q[0].w);
+
+		__m128 x2 = _mm_add_ps(x, x);
+		__m128 y2 = _mm_add_ps(y, y);
+		__m128 z2 = _mm_add_ps(z, z);
+
+		__m128 xx = _mm_mul_ps(x, x2);
+		__m128 yy = _mm_mul_ps(y, y2);
+		__m128 zz = _mm_mul_ps(z, z2);
+		__m128 xy = _mm_mul_ps(x, y2);
+		__m128 xz = _mm_mul_ps(x, z2);
+		__m128 yz = _mm_mul_ps(y, z2);
+		__m128 wx = _mm_mul_ps(w, x2);
+		__m128 wy = _mm_mul_ps(w, y2);
+		__m128 wz = _mm_mul_ps(w, z2);
+
+		__m128 sx = _mm_set_ps(s[3].x, s[2].x, s[1].x, s[0].x);
+		__m128 sy = _mm_set_ps(s[3].y, s[2].y, s[1].y, s[0].y);
+		__m128 sz = _mm_set_ps(s[3].z, s[2].z, s[1].z, s[0].z);
+
+		// rotation columns scaled, same as mat4_cast then scale
+		__m128 c0x = _mm_mul_ps(_mm_sub_ps(one, _mm_add_ps(yy, zz)), sx);
+		__m128 c0y = _mm_mul_ps(_mm_add_ps(xy, wz), sx);
+		__m128 c0z = _mm_mul_ps(_mm_sub_ps(xz, wy), sx);
+		__m128 c0w = zero;
+
+		__m128 c1x = _mm_mul_ps(_mm_sub_ps(xy, wz), sy);
+		__m128 c1y = _mm_mul_ps(_mm_sub_ps(one, _mm_add_ps(xx, zz)), sy);
+		__m128 c1z = _mm_mul_ps(_mm_add_ps(yz, wx), sy);
+		__m128 c1w = zero;
+
+		__m128 c2x = _mm_mul_ps(_mm_add_ps(xz, wy), sz);
+		__m128 c2y = _mm_mul_ps(_mm_sub_ps(yz, wx), sz);
+		__m128 c2z = _mm_mul_ps(_mm_sub_ps(one, _mm_add_ps(xx, yy)), sz);
+		__m128 c2w = zero;
+
+		__m128 c3x = _mm_set_ps(p[3].x, p[2].x, p[1].x, p[0].x);
+		__m128 c3y = _mm_set_ps(p[3].y, p[2].y, p[1].y, p[0].y);
+		__m128 c3z = _mm_set_ps(p[3].z, p[2].z, p[1].z, p[0].z);
+		__m128 c3w = one;
+
+		storeColumn(c0x, c0y, c0z, c0w, matrices + i, 0);
+		storeColumn(c1x, c1y, c1z, c1w, matrices + i, 1);
+		storeColumn(c2x, c2y, c2z, c2w, matrices + i, 2);
+		storeColumn(c3x, c3y, c3z, c3w, matrices + i, 3);
+	}
+
+	transformMatricesScalar(positions + i, rotations + i, scales + i, matrices + i, count - i);
+}
+
+// each column of the result is the left columns weighted by that column of the right
+static void multiplyMatricesSse(const glm::mat4& left, const glm::mat4* rights, glm::mat4* results, uint32_t count) {
+	const __m128 l0 = _mm_loadu_ps(&left[0][0]);
+	const __m128 l1 = _mm_loadu_ps(&left[1][0]);
+	const __m128 l2 = _mm_loadu_ps(&left[2][0]);
+	const __m128 l3 = _mm_loadu_ps(&left[3][0]);
+
+	for (uint32_t i = 0; i < count; i++) {
+		const float* right = &rights[i][0][0];
+		float* result = &results[i][0][0];
+
+		for (uint32_t j = 0; j < 16; j += 4) {
+			__m128 column = _mm_loadu_ps(right + j);
+
+			__m128 sum = _mm_mul_ps(l0, _mm_shuffle_ps(column, column, _MM_SHUFFLE(0, 0, 0, 0)));
+			sum = _mm_add_ps(sum, _mm_mul_ps(l1, _mm_shuffle_ps(column, column, _MM_SHUFFLE(1, 1, 1, 1))));
+			sum = _mm_add_ps(sum, _mm_mul_ps(l2, _mm_shuffle_ps(column, column, _MM_SHUFFLE(2, 2, 2, 2))));
+			sum = _mm_add_ps(sum, _mm_mul_ps(l3, _mm_shuffle_ps(column, column, _MM_SHUFFLE(3, 3, 3, 3))));
+
+			_mm_storeu_ps(result + j, sum);
+		}
+	}
+}
+
+// each half holds four matrices, stored like the sse kernel's
+KERNELS_AVX static inline void storeColumn(__m256 x, __m256 y, __m256 z, __m256 w, glm::mat4* matrices, uint32_t column) {
+	storeColumn(_mm256_castps256_ps128(x), _mm256_castps256_ps128(y), _mm256_castps256_ps128(z), _mm256_castps256_ps128(w), matrices, column);
+	storeColumn(_mm256_extractf128_ps(x, 1), _mm256_extractf128_ps(y, 1), _mm256_extractf128_ps(z, 1), _mm256_extractf128_ps(w, 1), matrices + 4, column);
+}
+
+// same as the sse kernel with eight lanes
+KERNELS_AVX static void transformMatricesAvx(const glm::vec3* positions, const glm::quat* rotations, const glm::vec3* scales, glm::mat4* matrices, uint32_t count) {
+	const __m256 one = _mm256_set1_ps(1.f);
+	const __m256 zero = _mm256_setzero_ps();
+
+	uint32_t i = 0;
+
+	for (; i + 8 <= count; i += 8) {
+		const glm::quat* q = rotations + i;
+		const glm::vec3* s = scales + i;
+		const glm::vec3* p = positions + i;
+
+		__m256 x = _mm256_set_ps(q[7].x, q[6].x, q[5].x, q[4].x, q[3].x, q[2].x, q[1].x, q[0].x);
+		__m256 y = _mm256_set_ps(q[7].y, q[6].y, q[5].y, q[4].y, q[3].y, q[2].y, q[1].y, q[0].y);
+		__m256 z = _mm256_set_ps(q[7].z, q[6].z, q[5].z, q[4].z, q[3].z, q[2].z, q[1].z, q[0].z);
+		__m256 w = _mm256_set_ps(q[7].w, q[6].w, q[5].w, q[4].w, q[3].w, q[2].w, q[1].w, q[0].w);
+
+		__m256 x2 = _mm256_add_ps(x, x);
+		__m256 y2 = _mm256_add_ps(y, y);
+		__m256 z2 = _mm256_add_ps(z, z);
+
+		__m256 xx = _mm256_mul_ps(x, x2);
+		__m256 yy = _mm256_mul_ps(y, y2);
+		__m256 zz = _mm256_mul_ps(z, z2);
+		__m256 xy = _mm256_mul_ps(x, y2);
+		__m256 xz = _mm256_mul_ps(x, z2);
+		__m256 yz = _mm256_mul_ps(y, z2);
+		__m256 wx = _mm256_mul_ps(w, x2);
+		__m256 wy = _mm256_mul_ps(w, y2);
+		__m256 wz = _mm256_mul_ps(w, z2);
+
+		__m256 sx = _mm256_set_ps(s[7].x, s[6].x, s[5].x, s[4].x, s[3].x, s[2].x, s[1].x, s[0].x);
+		__m256 sy = _mm256_set_ps(s[7].y, s[6].y, s[5].y, s[4].y, s[3].y, s[2].y, s[1].y, s[0].y);
+		__m256 sz = _mm256_set_ps(s[7].z, s[6].z, s[5].z, s[4].z, s[3].z, s[2].z, s[1].z, s[0].z);
+
+		storeColumn(
+			_mm256_mul_ps(_mm256_sub_ps(one, _mm256_add_ps(yy, zz)), sx),
+			_mm256_mul_ps(_mm256_add_ps(xy, wz), sx),
+			_mm256_mul_ps(_mm256_sub_ps(xz, wy), sx),
+			zero, matrices + i, 0);
+
+		storeColumn(
+			_mm256_mul_ps(_mm256_sub_ps(xy, wz), sy),
+			_mm256_mul_ps(_mm256_sub_ps(one, _mm256_add_ps(xx, zz)), sy),
+			_mm256_mul_ps(_mm256_add_ps(yz, wx), sy),
+			zero, matrices + i, 1);
+
+		storeColumn(
+			_mm256_mul_ps(_mm256_add_ps(xz, wy), sz),
+			_mm256_mul_ps(_mm256_sub_ps(yz, wx), sz),
+			_mm256_mul_ps(_mm256_sub_ps(one, _mm256_add_ps(xx, yy)), sz),
+			zero, matrices + i, 2);
+
+		storeColumn(
+			_mm256_set_ps(p[7].x, p[6].x, p[5].x, p[4].x, p[3].x, p[2].x, p[1].x, p[0].x),
+			_mm256_set_ps(p[7].y, p[6].y, p[5].y, p[4].y, p[3].y, p[2].y, p[1].y, p[0].y),
+			_mm256_set_ps(p[7].z, p[6].z, p[5].z, p[4].z, p[3].z, p[2].z, p[1].z, p[0].z),
+			one, matrices + i, 3);
+	}
+
+	transformMatricesSse(positions + i, rotations + i, scales + i, matrices + i, count - i);
+}
+
+// two columns at a time, each half of the register weighting the left columns by its own column
+KERNELS_AVX static void multiplyMatricesAvx(const glm::mat4& left, const glm::mat4* rights, glm::mat4* results, uint32_t count) {
+	const __m256 l0 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(&left[0][0]));
+	const __m256 l1 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(&left[1][0]));
+	const __m256 l2 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(&left[2][0]));
+	const __m256 l3 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(&left[3][0]));
+
+	for (uint32_t i = 0; i < count; i++) {
+		const float* right = &rights[i][0][0];
+		float* result = &results[i][0][0];
+
+		for (uint32_t j = 0; j < 16; j += 8) {
+			__m256 columns = _mm256_loadu_ps(right + j);
+
+			__m256 sum = _mm256_mul_ps(l0, _mm256_permute_ps(columns, 0x00));
+			sum = _mm256_add_ps(sum, _mm256_mul_ps(l1, _mm256_permute_ps(columns, 0x55)));
+			sum = _mm256_add_ps(sum, _mm256_mul_ps(l2, _mm256_permute_ps(columns, 0xAA)));
+			sum = _mm256_add_ps(sum, _mm256_mul_ps(l3, _mm256_permute_ps(columns, 0xFF)));
+
+			_mm256_storeu_ps(result + j, sum);
+		}
+	}
+}
+#endif
+
+void transformMatrices(const glm::vec3* positions, const glm::quat* rotations, const glm::vec3* scales, glm::mat4* matrices, uint32_t count) {
+	switch (selectedSet()) {
+#ifdef KERNELS_X86
+	case KernelSet::Avx:
+		transformMatricesAvx(positions, rotations, scales, matrices, count);
+		break;
+	case KernelSet::Sse:
+		transformMatricesSse(positions, rotations, scales, matrices, count);
+		break;
+#endif
+	default:
+		transformMatricesScalar(positions, rotations, scales, matrices, count);
+	}
+}
+
+void multiplyMatrices(const glm::mat4& left, const glm::mat4* rights, glm::mat4* results, uint32_t count) {
+	switch (selectedSet()) {
+#ifdef KERNELS_X86
+	case KernelSet::Avx:
+		multiplyMatricesAvx(left, rights, results, count);
+		break;
+	case KernelSet::Sse:
+		multiplyMatricesSse(left, rights, results, count);
+		break;
+#endif
+	default:
+		multiplyMatricesScalar(left, rights, results, count);
+	}
+}
+
+const char* transformKernels() {
+	switch (selectedSet()) {
+	case KernelSet::Avx:
+		return "avx";
+	case KernelSet::Sse:
+		return "sse";
+	default:
+		return "scalar";
+	}
+}
+
+bool useTransformKernels(const char* name) {
+	KernelSet set;
+
+	if (!strcmp(name, "avx"))
+		set = KernelSet::Avx;
+	else if (!strcmp(name, "sse"))
+		set = KernelSet::Sse;
+	else if (!strcmp(name, "scalar"))
+		set = KernelSet::Scalar;
+	else
+		return false;
+
+	if (set > kernelSet())
+		return false;
+
+	selectedSet() = set;
+
+	return true;
+}
\ No newline at end of file
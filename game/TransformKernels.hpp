@@ -0,0 +1,21 @@
+#pragma once
+
+#include <glm\vec3.hpp>
+#include <glm\gtc\quaternion.hpp>
+#include <glm\mat4x4.hpp>
+
+#include <cstdint>
+
+// kernels over arrays of transforms, using the widest instruction set the CPU supports, or plain glm without SSE
+
+// matrices[i] = translate(positions[i]) * mat4_cast(rotations[i]) * scale(scales[i])
+void transformMatrices(const glm::vec3* positions, const glm::quat* rotations, const glm::vec3* scales, glm::mat4* matrices, uint32_t count);
+
+// results[i] = left * rights[i], results can be rights
+void multiplyMatrices(const glm::mat4& left, const glm::mat4* rights, glm::mat4* results, uint32_t count);
+
+// instruction set the kernels use, "avx", "sse" or "scalar"
+const char* transformKernels();
+
+// picks the kernels' instruction set, false if the CPU doesn't support it, not while kernels are running
+bool useTransformKernels(const char* name);
\ No newline at end of file
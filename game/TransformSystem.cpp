@@ -0,0 +1,437 @@
+#include "TransformSystem.hpp"
+
+#include "Transform.hpp"
+#include "TransformKernels.hpp"
+
+#include <algorithm>
+
+TransformSystem::TransformSystem(Engine& engine) : _engine(engine) {
+	// after anything moving transforms, before anything drawing them
+	SYSFUNC_ENABLE(SystemInterface, update, 1).writes<Transform>();
+}
+
+uint32_t TransformSystem::_node(uint64_t id) const {
+	uint32_t index = front64(id);
+
+	if (!id || index >= _nodes.size())
+		return none;
+
+	uint32_t node = _nodes[index];
+
+	// entity index may have been reused
+	if (node == none || _ids[node] != id)
+		return none;
+
+	return node;
+}
+
+uint32_t TransformSystem::_parent(uint32_t node) const {
+	uint32_t parent = _parents[node];
+
+	// parent removed since sorting
+	if (parent == none || !_ids[parent])
+		return none;
+
+	return parent;
+}
+
+void TransformSystem::_markDirty(uint32_t node) {
+	_dirty[node] = true;
+	_clean = false;
+}
+
+void TransformSystem::_detach(uint32_t node) {
+	uint32_t parent = _parent(node);
+
+	if (parent != none)
+		_childCounts[parent]--;
+
+	_parents[node] = none;
+
+	_markDirty(node);
+	_sorted = false;
+}
+
+void TransformSystem::_sort() {
+	if (_sorted)
+		return;
+
+	const uint32_t count = static_cast<uint32_t>(_ids.size());
+
+	// children of each node in node order, counted then placed by parent
+	_offsets.assign(count + 1, 0);
+	_order.clear();
+
+	for (uint32_t i = 0; i < count; i++) {
+		if (!_ids[i])
+			continue;
+
+		// children of removed nodes become roots
+		if (_parents[i] != none && !_ids[_parents[i]]) {
+			_parents[i] = none;
+			_dirty[i] = true;
+		}
+
+		if (_parents[i] == none)
+			_order.push_back(i);
+		else
+			_offsets[_parents[i] + 1]++;
+	}
+
+	for (uint32_t i = 0; i < count; i++)
+		_offsets[i + 1] += _offsets[i];
+
+	_children.resize(_offsets[count]);
+
+	for (uint32_t i = 0; i < count; i++) {
+		if (_ids[i] && _parents[i] != none)
+			_children[_offsets[_parents[i]]++] = i;
+	}
+
+	// placing moved each offset to the next node's start
+	for (uint32_t i = count; i > 0; i--)
+		_offsets[i] = _offsets[i - 1];
+
+	_offsets[0] = 0;
+
+	// breadth first from the roots, so each node's children are added together
+	_levels.clear();
+	_firstChildren.resize(count);
+
+	size_t levelStart = 0;
+
+	while (levelStart < _order.size()) {
+		_levels.push_back(static_cast<uint32_t>(levelStart));
+
+		size_t levelEnd = _order.size();
+
+		for (size_t i = levelStart; i < levelEnd; i++) {
+			uint32_t node = _order[i];
+
+			_firstChildren[node] = static_cast<uint32_t>(_order.size());
+			_childCounts[node] = _offsets[node + 1] - _offsets[node];
+			_order.insert(_order.end(), _children.begin() + _offsets[node], _children.begin() + _offsets[node + 1]);
+		}
+
+		levelStart = levelEnd;
+	}
+
+	_levels.push_back(static_cast<uint32_t>(_order.size()));
+
+	// old node index to new, in place of the no longer needed offsets
+	for (uint32_t i = 0; i < _order.size(); i++)
+		_offsets[_order[i]] = i;
+
+	for (uint32_t i = 0; i < count; i++) {
+		if (_parents[i] != none)
+			_parents[i] = _offsets[_parents[i]];
+	}
+
+	_reorder(&_ids);
+	_reorder(&_parents);
+	_reorder(&_firstChildren);
+	_reorder(&_childCounts);
+	_reorder(&_dirty);
+	_reorder(&_positions);
+	_reorder(&_rotations);
+	_reorder(&_scales);
+	_reorder(&_globalPositions);
+	_reorder(&_globalRotations);
+	_reorder(&_globalScales);
+	_reorder(&_globalMatrices);
+
+	for (uint32_t i = 0; i < _ids.size(); i++)
+		_nodes[front64(_ids[i])] = i;
+
+	_sorted = true;
+}
+
+template <typename T>
+void TransformSystem::_reorder(std::vector<T>* values) {
+	std::vector<T> reordered(_order.size());
+
+	for (uint32_t i = 0; i < _order.size(); i++)
+		reordered[i] = (*values)[_order[i]];
+
+	values->swap(reordered);
+}
+
+void TransformSystem::_compose(uint32_t node) {
+	uint32_t parent = _parent(node);
+
+	if (parent != none) {
+		_globalPositions[node] = _globalPositions[parent] + _globalRotations[parent] * _positions[node];
+		_globalRotations[node] = _globalRotations[parent] * _rotations[node];
+		_globalScales[node] = _globalScales[parent] * _scales[node];
+	}
+	else {
+		_globalPositions[node] = _positions[node];
+		_globalRotations[node] = _rotations[node];
+		_globalScales[node] = _scales[node];
+	}
+}
+
+bool TransformSystem::_resolve(uint32_t node) {
+	uint32_t parent = _parents[node];
+
+	// recomputed if anything above changed, dirty flags are left for the pass
+	bool changed = _dirty[node];
+
+	if (parent != none && !_ids[parent])
+		changed = true; // parent removed since sorting, so now a root
+	else if (parent != none && _resolve(parent))
+		changed = true;
+
+	if (changed)
+		_compose(node);
+
+	return changed;
+}
+
+uint32_t TransformSystem::_firstChild(uint64_t id) {
+	uint32_t node = _node(id);
+
+	if (node == none || !_childCounts[node])
+		return none;
+
+	_sort();
+
+	// node may have moved
+	return _firstChildren[_node(id)];
+}
+
+void TransformSystem::_updateRange(uint32_t begin, uint32_t end) {
+	for (uint32_t i = begin; i < end; i++) {
+		if (_parents[i] != none && _dirty[_parents[i]])
+			_dirty[i] = true;
+
+		if (_dirty[i])
+			_compose(i);
+	}
+
+	// matrices for each run of dirty nodes
+	for (uint32_t i = begin; i < end;) {
+		if (!_dirty[i]) {
+			i++;
+			continue;
+		}
+
+		uint32_t run = i + 1;
+
+		while (run < end && _dirty[run])
+			run++;
+
+		transformMatrices(&_globalPositions[i], &_globalRotations[i], &_globalScales[i], &_globalMatrices[i], run - i);
+
+		i = run;
+	}
+}
+
+void TransformSystem::update(double) {
+	if (_clean)
+		return;
+
+	_sort();
+
+	// a level at a time, as each only reads the one before, so its nodes can be split across threads
+	for (uint32_t level = 0; level + 1 < _levels.size(); level++) {
+		const uint32_t first = _levels[level];
+
+		_engine.parallelFor(_levels[level + 1] - first, [&](uint32_t begin, uint32_t end) {
+			_updateRange(first + begin, first + end);
+		}, batchSize);
+	}
+
+	std::fill(_dirty.begin(), _dirty.end(), false);
+
+	_clean = true;
+}
+
+void TransformSystem::add(uint64_t id) {
+	uint32_t index = front64(id);
+
+	if (index >= _nodes.size())
+		_nodes.resize(index + 1, none);
+
+	assert(_node(id) == none);
+
+	_nodes[index] = static_cast<uint32_t>(_ids.size());
+
+	_ids.push_back(id);
+	_parents.push_back(none);
+	_firstChildren.push_back(none);
+	_childCounts.push_back(0);
+	_dirty.push_back(true);
+
+	_positions.emplace_back();
+	_rotations.emplace_back();
+	_scales.emplace_back(1, 1, 1);
+
+	_globalPositions.emplace_back();
+	_globalRotations.emplace_back();
+	_globalScales.emplace_back(1, 1, 1);
+	_globalMatrices.emplace_back();
+
+	// roots must come first
+	_sorted = false;
+	_clean = false;
+}
+
+void TransformSystem::remove(uint64_t id) {
+	uint32_t node = _node(id);
+
+	if (node == none)
+		return;
+
+	_detach(node);
+
+	// left in place until sorted, children see it's gone then
+	_ids[node] = 0;
+	_nodes[front64(id)] = none;
+}
+
+bool TransformSystem::has(uint64_t id) const {
+	return _node(id) != none;
+}
+
+void TransformSystem::setParent(uint64_t id, uint64_t parentId) {
+	uint32_t node = _node(id);
+	uint32_t parent = _node(parentId);
+
+	if (node == none || (parentId && parent == none) || _parent(node) == parent)
+		return;
+
+	// parenting to a child would make a loop
+	for (uint32_t i = parent; i != none; i = _parent(i)) {
+		if (i == node)
+			return;
+	}
+
+	_detach(node);
+	_engine.markChanged<Transform>(id);
+
+	if (parent == none)
+		return;
+
+	_parents[node] = parent;
+	_childCounts[parent]++;
+}
+
+void TransformSystem::removeChildren(uint64_t id) {
+	uint32_t node = _node(id);
+
+	if (node == none || !_childCounts[node])
+		return;
+
+	_sort();
+
+	// node may have moved
+	node = _node(id);
+
+	const uint32_t first = _firstChildren[node];
+
+	for (uint32_t i = first; i < first + _childCounts[node]; i++) {
+		_parents[i] = none;
+		_markDirty(i);
+		_engine.markChanged<Transform>(_ids[i]);
+	}
+
+	_childCounts[node] = 0;
+	_sorted = false;
+}
+
+uint64_t TransformSystem::parent(uint64_t id) const {
+	uint32_t node = _node(id);
+
+	if (node == none)
+		return 0;
+
+	uint32_t parent = _parent(node);
+
+	if (parent == none)
+		return 0;
+
+	return _ids[parent];
+}
+
+uint32_t TransformSystem::childCount(uint64_t id) const {
+	uint32_t node = _node(id);
+
+	if (node == none)
+		return 0;
+
+	return _childCounts[node];
+}
+
+glm::vec3 TransformSystem::position(uint64_t id) const {
+	uint32_t node = _node(id);
+	assert(node != none);
+
+	return _positions[node];
+}
+
+glm::quat TransformSystem::rotation(uint64_t id) const {
+	uint32_t node = _node(id);
+	assert(node != none);
+
+	return _rotations[node];
+}
+
+glm::vec3 TransformSystem::scale(uint64_t id) const {
+	uint32_t node = _node(id);
+	assert(node != none);
+
+	return _scales[node];
+}
+
+void TransformSystem::setPosition(uint64_t id, const glm::vec3& position) {
+	uint32_t node = _node(id);
+	assert(node != none);
+
+	_positions[node] = position;
+	_markDirty(node);
+
+	_engine.markChanged<Transform>(id);
+}
+
+void TransformSystem::setRotation(uint64_t id, const glm::quat& rotation) {
+	uint32_t node = _node(id);
+	assert(node != none);
+
+	_rotations[node] = rotation;
+	_markDirty(node);
+
+	_engine.markChanged<Transform>(id);
+}
+
+void TransformSystem::setScale(uint64_t id, const glm::vec3& scale) {
+	uint32_t node = _node(id);
+	assert(node != none);
+
+	_scales[node] = scale;
+	_markDirty(node);
+
+	_engine.markChanged<Transform>(id);
+}
+
+const glm::mat4& TransformSystem::globalMatrix(uint64_t id) const {
+	uint32_t node = _node(id);
+	assert(node != none);
+	assert(_clean && "transforms changed since the pass, use updateGlobalMatrix");
+
+	return _globalMatrices[node];
+}
+
+const glm::mat4& TransformSystem::updateGlobalMatrix(uint64_t id) {
+	uint32_t node = _node(id);
+	assert(node != none);
+
+	if (!_clean && _resolve(node))
+		transformMatrices(&_globalPositions[node], &_globalRotations[node], &_globalScales[node], &_globalMatrices[node], 1);
+
+	return _globalMatrices[node];
+}
+
+uint32_t TransformSystem::size() const {
+	return static_cast<uint32_t>(_ids.size());
+}
\ No newline at end of file
@@ -0,0 +1,122 @@
+#pragma once
+
+#include "SystemInterface.hpp"
+
+#include <glm\vec3.hpp>
+#include <glm\gtc\quaternion.hpp>
+#include <glm\mat4x4.hpp>
+
+#include <vector>
+
+// hierarchy and transforms in flat arrays sorted by depth, so update is one forward pass and children are a range
+class TransformSystem : public SystemInterface {
+public:
+	static constexpr uint32_t none = UINT32_MAX;
+
+	// nodes of a level given to each thread in the pass, levels with fewer are done on the calling thread
+	static constexpr uint32_t batchSize = 4096;
+
+private:
+	Engine& _engine;
+
+	// per node, in depth order when sorted
+	std::vector<uint64_t> _ids; // 0 once removed, until sorted out
+	std::vector<uint32_t> _parents; // node indexes, none for roots
+	std::vector<uint32_t> _firstChildren; // only valid when sorted
+	std::vector<uint32_t> _childCounts;
+	std::vector<uint8_t> _dirty; // local transform or parent changed since the last pass, not set on children
+
+	std::vector<glm::vec3> _positions;
+	std::vector<glm::quat> _rotations;
+	std::vector<glm::vec3> _scales;
+
+	// cached, only recomputed for dirty nodes and the nodes below them
+	std::vector<glm::vec3> _globalPositions;
+	std::vector<glm::quat> _globalRotations;
+	std::vector<glm::vec3> _globalScales;
+	std::vector<glm::mat4> _globalMatrices;
+
+	std::vector<uint32_t> _levels; // first node of each depth, then one past the last node, only valid when sorted
+
+	std::vector<uint32_t> _nodes; // by entity index, none if without a transform
+
+	bool _sorted = true;
+	bool _clean = true; // nothing dirty since the last pass
+
+	// kept between sorts
+	std::vector<uint32_t> _order;
+	std::vector<uint32_t> _offsets;
+	std::vector<uint32_t> _children;
+
+	uint32_t _node(uint64_t id) const;
+	uint32_t _parent(uint32_t node) const;
+
+	void _markDirty(uint32_t node);
+	void _detach(uint32_t node);
+
+	void _sort();
+
+	template <typename T>
+	void _reorder(std::vector<T>* values);
+
+	// nodes on one level, whose parents are done
+	void _updateRange(uint32_t begin, uint32_t end);
+
+	// global position, rotation and scale, matrices are made by the caller
+	void _compose(uint32_t node);
+	bool _resolve(uint32_t node);
+
+	// sorted first, so children are next to each other, none without any
+	uint32_t _firstChild(uint64_t id);
+
+public:
+	TransformSystem(Engine& engine);
+
+	void update(double dt) final;
+
+	// called by Transform when added and removed, a removed transform's children become roots
+	void add(uint64_t id);
+	void remove(uint64_t id);
+
+	bool has(uint64_t id) const;
+
+	// 0 to remove parent, does nothing if parent is id or below it
+	void setParent(uint64_t id, uint64_t parent);
+	void removeChildren(uint64_t id);
+
+	uint64_t parent(uint64_t id) const;
+	uint32_t childCount(uint64_t id) const;
+
+	// copied, as finding them may sort the arrays, takes any allocator so a FrameVector can be used
+	template <typename Allocator>
+	void children(uint64_t id, std::vector<uint64_t, Allocator>* ids);
+
+	glm::vec3 position(uint64_t id) const;
+	glm::quat rotation(uint64_t id) const;
+	glm::vec3 scale(uint64_t id) const;
+
+	// setters and parenting mark the entity's Transform changed, for changed<Transform> filters
+	void setPosition(uint64_t id, const glm::vec3& position);
+	void setRotation(uint64_t id, const glm::quat& rotation);
+	void setScale(uint64_t id, const glm::vec3& scale);
+
+	// as of the last pass, so readers don't write and can share a wave, asserts nothing changed since
+	const glm::mat4& globalMatrix(uint64_t id) const;
+
+	// up to date even between passes, so a write
+	const glm::mat4& updateGlobalMatrix(uint64_t id);
+
+	uint32_t size() const;
+};
+
+template <typename Allocator>
+void TransformSystem::children(uint64_t id, std::vector<uint64_t, Allocator>* ids) {
+	uint32_t first = _firstChild(id);
+
+	if (first == none) {
+		ids->clear();
+		return;
+	}
+
+	ids->assign(_ids.begin() + first, _ids.begin() + first + childCount(id));
+}
\ No newline at end of file
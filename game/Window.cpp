@@ -1,5 +1,10 @@
 #include "Window.hpp"
 
+// complete system types, so events are called on them directly
+#include "Controller.hpp"
+#include "Renderer.hpp"
+#include "TransformSystem.hpp"
+
 #include <SDL_keyboard.h>
 #include <unordered_map>
 
@@ -189,8 +194,9 @@ void Window::_recreateWindow(){
 
 Window::Window(Engine& engine, const ConstructorInfo& constructorInfo) : _engine(engine), _constructorInfo(constructorInfo){
 	SYSFUNC_ENABLE(SystemInterface, initiate, -1);
-	SYSFUNC_ENABLE(SystemInterface, update, -1);
-	SYSFUNC_ENABLE(SystemInterface, lateUpdate, 1);
+	// sdl events and the gl context belong to the window's thread, and input changes other systems
+	SYSFUNC_ENABLE(SystemInterface, update, -1).reads<>().mainThread();
+	SYSFUNC_ENABLE(SystemInterface, lateUpdate, 1).reads<>().mainThread();
 }
 
 Window::~Window(){
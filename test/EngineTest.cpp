@@ -0,0 +1,128 @@
+#include <SimpleEngine.hpp>
+
+#include <cstdio>
+#include <cstdint>
+#include <vector>
+
+// checks engine rules which callers depend on, returns non zero if any fail
+
+class TestSystem : public SimpleEngine<TestSystem, 32>::BaseSystem {};
+
+struct Position {
+	float x, y, z;
+};
+
+struct Velocity {
+	float x, y, z;
+};
+
+#define CHECK(condition) \
+	if (!(condition)) { \
+		printf("%s:%d failed: %s\n", __FILE__, __LINE__, #condition); \
+		return false; \
+	}
+
+// adds of new components and creates during a pass are done once it's over, and only seen by passes after it
+static bool iteration() {
+	TestSystem::Engine engine(4096);
+
+	std::vector<uint64_t> ids(4);
+	engine.createEntities(static_cast<uint32_t>(ids.size()), ids.data());
+	engine.addComponents<Position>(ids.data(), static_cast<uint32_t>(ids.size()), Position{ 1.f, 2.f, 3.f });
+
+	CHECK(!engine.iterating());
+
+	std::vector<uint64_t> created;
+	uint32_t visited = 0;
+	bool failed = false;
+
+	engine.each<Position>([&](uint64_t id, Position& position) {
+		visited++;
+
+		// adding again doesn't change structure, so returns the one it has
+		failed |= !engine.iterating();
+		failed |= engine.addComponent<Position>(id) != &position;
+
+		// new components are added once the pass is done
+		failed |= engine.addComponent<Velocity>(id, Velocity{ 4.f, 5.f, 6.f }) != nullptr;
+		failed |= engine.hasComponents<Velocity>(id);
+
+		uint64_t other = engine.createEntity();
+		engine.addComponent<Position>(other);
+		created.push_back(other);
+	});
+
+	CHECK(!failed);
+	CHECK(visited == ids.size());
+	CHECK(!engine.iterating());
+
+	for (uint64_t id : ids) {
+		CHECK(engine.hasComponents<Velocity>(id));
+		CHECK(engine.getComponent<Velocity>(id)->y == 5.f);
+	}
+
+	for (uint64_t id : created)
+		CHECK(engine.hasComponents<Position>(id));
+
+	// a remove then add in the same pass leaves the added one
+	engine.each<Velocity>([&](uint64_t id, Velocity&) {
+		engine.removeComponent<Velocity>(id);
+		engine.addComponent<Velocity>(id, Velocity{ 7.f, 8.f, 9.f });
+	});
+
+	for (uint64_t id : ids)
+		CHECK(engine.hasComponents<Velocity>(id) && engine.getComponent<Velocity>(id)->x == 7.f);
+
+	// created entities are visited by the next pass
+	visited = 0;
+
+	engine.each<Position>([&](uint64_t, Position&) {
+		visited++;
+	});
+
+	CHECK(visited == ids.size() + created.size());
+
+	return true;
+}
+
+// writes through getComponent are only seen by changed filters once marked
+static bool changes() {
+	TestSystem::Engine engine(4096);
+
+	std::vector<uint64_t> ids(4);
+	engine.createEntities(static_cast<uint32_t>(ids.size()), ids.data());
+	engine.addComponents<Position>(ids.data(), static_cast<uint32_t>(ids.size()));
+
+	uint32_t since = engine.tick();
+	uint32_t visited = 0;
+	bool failed = false;
+
+	engine.getComponent<Position>(ids[1])->x = 1.f;
+	engine.getComponent<Position>(ids[2])->x = 2.f;
+	engine.markChanged<Position>(ids[2]);
+
+	// does nothing without the component
+	engine.markChanged<Velocity>(ids[3]);
+
+	engine.each<const Position>([&](uint64_t id, const Position&) {
+		visited++;
+		failed |= id != ids[2];
+	}, changed<Position>(since));
+
+	CHECK(!failed);
+	CHECK(visited == 1);
+	CHECK(!engine.hasComponents<Velocity>(ids[3]));
+
+	return true;
+}
+
+int main() {
+	bool passed = true;
+
+	passed &= iteration();
+	passed &= changes();
+
+	printf(passed ? "passed\n" : "failed\n");
+
+	return passed ? 0 : 1;
+}
\ No newline at end of file
@@ -0,0 +1,77 @@
+#include "Transform.hpp"
+#include "TransformSystem.hpp"
+
+#include <cstdio>
+#include <cstdint>
+
+// checks transforms against the engine's rules, built with the game's transform sources, returns non zero if any fail
+
+#define CHECK(condition) \
+	if (!(condition)) { \
+		printf("%s:%d failed: %s\n", __FILE__, __LINE__, #condition); \
+		return false; \
+	}
+
+static uint32_t changedSince(SystemInterface::Engine& engine, uint32_t since) {
+	uint32_t count = 0;
+
+	engine.each<const Transform>([&](uint64_t, const Transform&) {
+		count++;
+	}, changed<Transform>(since));
+
+	return count;
+}
+
+// transforms live in the transform system, so its setters mark them changed rather than iteration
+static bool changes() {
+	SystemInterface::Engine engine(4096);
+	engine.registerSystem<TransformSystem>(engine);
+
+	uint64_t parent = engine.createEntity();
+	uint64_t child = engine.createEntity();
+
+	engine.addComponent<Transform>(parent);
+	engine.addComponent<Transform>(child);
+
+	uint32_t since = engine.tick();
+
+	CHECK(changedSince(engine, since) == 0);
+
+	engine.getComponent<Transform>(child)->setPosition(glm::vec3(1.f, 2.f, 3.f));
+
+	CHECK(changedSince(engine, since) == 1);
+
+	since = engine.tick();
+
+	engine.system<TransformSystem>().setRotation(parent, glm::quat(0.f, 0.f, 0.f, 1.f));
+	engine.system<TransformSystem>().setScale(child, glm::vec3(2.f, 2.f, 2.f));
+
+	CHECK(changedSince(engine, since) == 2);
+
+	// parenting changes the child's global transform
+	since = engine.tick();
+
+	engine.getComponent<Transform>(parent)->addChild(child);
+
+	CHECK(changedSince(engine, since) == 1);
+
+	uint64_t changedId = 0;
+
+	engine.each<const Transform>([&](uint64_t id, const Transform&) {
+		changedId = id;
+	}, changed<Transform>(since));
+
+	CHECK(changedId == child);
+
+	return true;
+}
+
+int main() {
+	bool passed = true;
+
+	passed &= changes();
+
+	printf(passed ? "passed\n" : "failed\n");
+
+	return passed ? 0 : 1;
+}